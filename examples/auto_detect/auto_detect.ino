@@ -0,0 +1,93 @@
+#include <Arduino.h>
+
+#include <MSF-Time-Lib.h>
+
+// a 60kHz receiver module picks up MSF, WWVB and JJY from Mount Hagane, which one depends on where
+// in the world it is. We decode all three from the same pin and keep whichever passes the checksum
+// first, the other two are stopped then.
+#define INPUT_PIN 3
+
+bool readInput() { return digitalRead(INPUT_PIN) == LOW; }
+
+MSFReceiver<1> msf(readInput);
+MSFReceiver<1, WWVBProtocol<>> wwvb(readInput);
+MSFReceiver<1, JJYProtocol<>> jjy(readInput);
+
+// signal we locked to, nullptr until one of them decodes
+const char* detected = nullptr;
+
+void printDigits(int digits) {
+  Serial.print(":");
+  if (digits < 10) Serial.print('0');
+  Serial.print(digits);
+}
+
+void printResult(const MSFData& validData) {
+  Serial.print(detected);
+  Serial.print(F(" RESULT: "));
+  Serial.print(validData.year);
+  Serial.print('-');
+  if (validData.month < 10) Serial.print('0');
+  Serial.print(validData.month);
+  Serial.print('-');
+  if (validData.day < 10) Serial.print('0');
+  Serial.print(validData.day);
+  Serial.print('T');
+  if (validData.hour < 10) Serial.print('0');
+  Serial.print(validData.hour);
+  printDigits(validData.minute);
+  printDigits(validData.second);
+  Serial.println(F(" "));
+}
+
+// ticks a receiver that is still looking for its signal, a minute that failed the checksum just
+// starts it again
+template <class RECEIVER>
+bool decoded(RECEIVER& receiver) {
+  if (!receiver.tick()) return false;
+  if (receiver.get_result().checksumPassed) return true;
+  receiver.start();
+  return false;
+}
+
+// keeps the receiver that decoded first in tracking mode and stops the rest
+template <class RECEIVER>
+void lockTo(RECEIVER& receiver, const char* name) {
+  detected = name;
+  printResult(receiver.get_result());
+  msf.stop();
+  wwvb.stop();
+  jjy.stop();
+  receiver.start_tracking();
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(INPUT_PIN, INPUT_PULLUP);
+
+  randomSeed(analogRead(0));
+
+  Serial.println(F(">>> SYSTEM STARTUP"));
+  Serial.println(F(">>> LISTENING FOR MSF, WWVB AND JJY"));
+  msf.start();
+  wwvb.start();
+  jjy.start();
+}
+
+void loop() {
+  if (detected == nullptr) {
+    // each receiver samples the pin on its own schedule, so they all need to be ticked every loop
+    if (decoded(msf))
+      lockTo(msf, "MSF");
+    else if (decoded(wwvb))
+      lockTo(wwvb, "WWVB");
+    else if (decoded(jjy))
+      lockTo(jjy, "JJY");
+    return;
+  }
+
+  // only one of them runs now, the stopped ones never have a result
+  if (msf.tick() && msf.get_result().checksumPassed) printResult(msf.get_result());
+  if (wwvb.tick() && wwvb.get_result().checksumPassed) printResult(wwvb.get_result());
+  if (jjy.tick() && jjy.get_result().checksumPassed) printResult(jjy.get_result());
+}
@@ -0,0 +1,72 @@
+#include <Arduino.h>
+
+#include <MSF-Time-Lib.h>
+
+// this example uses the hardware timer API of arduino-esp32 3.x, on other boards push the samples
+// from any timer interrupt the same way
+#if !defined(ARDUINO_ARCH_ESP32)
+#error "This example is for ESP32, see onSampleTimer() for what to port"
+#endif
+
+#define INPUT_PIN 3
+#define SAMPLE_PERIOD_US 500
+
+// filled by the timer interrupt every 500us, drained by msf.tick() once per block
+MSFSampleBuffer samples(SAMPLE_PERIOD_US);
+
+MSFReceiver<1> msf(samples);
+
+hw_timer_t* sampleTimer = nullptr;
+
+void IRAM_ATTR onSampleTimer() { samples.push_sample(digitalRead(INPUT_PIN)); }
+
+void printDigits(int digits) {
+  Serial.print(":");
+  if (digits < 10) Serial.print('0');
+  Serial.print(digits);
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(INPUT_PIN, INPUT_PULLUP);
+
+  // 1MHz timer ticks, alarm every sample period
+  sampleTimer = timerBegin(1000000);
+  timerAttachInterrupt(sampleTimer, &onSampleTimer);
+  timerAlarm(sampleTimer, SAMPLE_PERIOD_US, true, 0);
+
+  randomSeed(analogRead(0));
+
+  Serial.println(F(">>> SYSTEM STARTUP"));
+  Serial.println(F(">>> WAITING FOR RADIO SYNC (NON-BLOCKING, BLOCK SAMPLING)"));
+  msf.start_tracking();
+}
+
+void loop() {
+  // tick() takes all samples it needs from the blocks sampled since the last call, and the next
+  // block is all it waits for, so the loop only wakes up once per block (128ms by default)
+  if (msf.tick()) {
+    const MSFData& validData = msf.get_result();
+    if (validData.checksumPassed) {
+      Serial.print(F("RESULT: "));
+      Serial.print(validData.year);
+      Serial.print('-');
+      if (validData.month < 10) Serial.print('0');
+      Serial.print(validData.month);
+      Serial.print('-');
+      if (validData.day < 10) Serial.print('0');
+      Serial.print(validData.day);
+      Serial.print('T');
+      if (validData.hour < 10) Serial.print('0');
+      Serial.print(validData.hour);
+      printDigits(validData.minute);
+      printDigits(validData.second);
+      Serial.println(F(" "));
+    } else {
+      Serial.println(F("Checksum failed, waiting for the next minute..."));
+    }
+  }
+
+  if (samples.check_and_clear_overflow()) Serial.println(F("Sample buffer overflow!"));
+  delay(msf.get_time_until_next_event() / 1000 + 1);
+}
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+
+#include <MSF-Time-Lib.h>
+
+// must be a pin that supports interrupts, see digitalPinToInterrupt() docs for your board
+#define INPUT_PIN 3
+
+// filled by the pin change interrupt, drained by msf.tick()
+MSFEdgeBuffer edges;
+
+MSFReceiver<1> msf(edges);
+
+void onCarrierEdge() { edges.push(micros(), digitalRead(INPUT_PIN) == LOW); }
+
+void printDigits(int digits) {
+  Serial.print(":");
+  if (digits < 10) Serial.print('0');
+  Serial.print(digits);
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(INPUT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(INPUT_PIN), onCarrierEdge, CHANGE);
+
+  randomSeed(analogRead(0));
+
+  Serial.println(F(">>> SYSTEM STARTUP"));
+  Serial.println(F(">>> WAITING FOR RADIO SYNC (NON-BLOCKING, EDGE CAPTURE)"));
+  msf.start();
+}
+
+void loop() {
+  // in edge capture mode tick() catches up on all edges since the last call, so the loop is free
+  // to do other work as long as it calls tick() before the edge buffer fills up
+  if (msf.tick()) {
+    const MSFData& validData = msf.get_result();
+    if (validData.checksumPassed) {
+      Serial.print(F("RESULT: "));
+      Serial.print(validData.year);
+      Serial.print('-');
+      if (validData.month < 10) Serial.print('0');
+      Serial.print(validData.month);
+      Serial.print('-');
+      if (validData.day < 10) Serial.print('0');
+      Serial.print(validData.day);
+      Serial.print('T');
+      if (validData.hour < 10) Serial.print('0');
+      Serial.print(validData.hour);
+      printDigits(validData.minute);
+      printDigits(validData.second);
+      Serial.println(F(" "));
+    } else {
+      Serial.println(F("Checksum failed, retrying..."));
+    }
+    msf.start();
+  }
+
+  if (edges.check_and_clear_overflow()) Serial.println(F("Edge buffer overflow!"));
+  delay(50);
+}
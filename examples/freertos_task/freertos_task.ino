@@ -0,0 +1,61 @@
+#include <Arduino.h>
+
+#include <MSF-Time-Lib.h>
+
+#if !defined(ARDUINO_ARCH_ESP32)
+#error "MSFTask needs FreeRTOS of arduino-esp32"
+#endif
+
+// must be a pin that supports interrupts
+#define INPUT_PIN 3
+
+// filled by the pin change interrupt, drained by the task
+MSFEdgeBuffer edges;
+
+MSFReceiver<1> msf(edges);
+MSFTask<MSFReceiver<1>> msfTask(msf);
+
+void IRAM_ATTR onCarrierEdge() { edges.push(micros(), digitalRead(INPUT_PIN) == LOW); }
+
+void printDigits(int digits) {
+  Serial.print(":");
+  if (digits < 10) Serial.print('0');
+  Serial.print(digits);
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(INPUT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(INPUT_PIN), onCarrierEdge, CHANGE);
+
+  randomSeed(analogRead(0));
+
+  Serial.println(F(">>> SYSTEM STARTUP"));
+  Serial.println(F(">>> WAITING FOR RADIO SYNC (FREERTOS TASK)"));
+  // core 1 at priority 1, Wi-Fi on core 0 does not notice it
+  if (!msfTask.begin()) Serial.println(F("Could not start the MSF task!"));
+}
+
+void loop() {
+  // the task decodes every minute on its own, here we just wait for the next one that passed the
+  // checksum, loop() could as well do anything else and poll with a timeout of 0
+  MSFData validData;
+  if (!msfTask.wait_for_result(validData, pdMS_TO_TICKS(5000))) {
+    if (edges.check_and_clear_overflow()) Serial.println(F("Edge buffer overflow!"));
+    return;
+  }
+  Serial.print(F("RESULT: "));
+  Serial.print(validData.year);
+  Serial.print('-');
+  if (validData.month < 10) Serial.print('0');
+  Serial.print(validData.month);
+  Serial.print('-');
+  if (validData.day < 10) Serial.print('0');
+  Serial.print(validData.day);
+  Serial.print('T');
+  if (validData.hour < 10) Serial.print('0');
+  Serial.print(validData.hour);
+  printDigits(validData.minute);
+  printDigits(validData.second);
+  Serial.println(F(" "));
+}
@@ -10,6 +10,17 @@
 bool readInput() { return digitalRead(INPUT_PIN) == LOW; }
 
 MSFReceiver<1> msf(readInput);
+MSFClock msfClock;
+
+// TimeLib sync provider. TimeLib starts counting its second when this returns, so we wait for the
+// next second of the clock and return that one, or TimeLib would be up to a second behind
+time_t msfNow() {
+  if (!msfClock.is_synced()) return 0;
+  uint16_t ms;
+  uint32_t seconds = msfClock.now(ms);
+  delay(1000 - ms);
+  return seconds + 1;
+}
 
 void printDigits(int digits) {
   Serial.print(":");
@@ -29,22 +40,21 @@ void setup() {
 
   Serial.println(F(">>> SYSTEM STARTUP"));
   Serial.println(F(">>> WAITING FOR RADIO SYNC (BLOCKING)"));
+  // TimeLib takes the drift corrected time from the clock every 5 minutes
+  setSyncProvider(msfNow);
+  setSyncInterval(300);
 }
 
 void loop() {
   while (1) {
     // get MSF time, this will block until we get a valid reading with correct checksum
     MSFData validData = msf.get_time_with_retry();
-    // put the time we got from MSF signal into TimeLib format and set the system time, now we can
-    // use TimeLib functions to get the current time and print it in human readable format
-    tmElements_t tElements_time;
-    tElements_time.Second = validData.second;
-    tElements_time.Minute = validData.minute;
-    tElements_time.Hour = validData.hour;
-    tElements_time.Day = validData.day;
-    tElements_time.Month = validData.month;
-    tElements_time.Year = uint8_t(validData.year - 1970);
-    setTime(makeTime(tElements_time));
+    // discipline the clock with the minute edge we just decoded and set the system time from it,
+    // now we can use TimeLib functions to get the current time and print it in human readable
+    // format. The clock keeps the time between fixes and learns how fast our millis() drifts.
+    msfClock.update(validData);
+    // take the new fix straight away instead of at the next sync interval
+    setTime(msfNow());
     Serial.print(F("RESULT: "));
     Serial.print(year());
     Serial.print('-');
@@ -0,0 +1,118 @@
+#pragma once
+
+// Just enough of the Arduino API to build the library on a PC, see the
+// "Simulation on a PC" section of README. Time is virtual, it only moves when
+// the code sleeps or asks for it, every micros() and millis() call costs
+// MSFHost::call_cost_us() so busy loops still make progress. Minutes of
+// signal run in milliseconds this way.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define F(string) (string)
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+namespace MSFHost {
+
+/// @brief Returns the virtual time in microseconds since the start
+inline uint64_t& clock_us() {
+  static uint64_t now = 0;
+  return now;
+}
+
+/// @brief Returns how many microseconds every micros() and millis() call
+/// takes, roughly what they cost on a 16MHz AVR
+inline uint32_t& call_cost_us() {
+  static uint32_t cost = 2;
+  return cost;
+}
+
+/// @brief Moves the virtual time forward
+/// @param us Microseconds to move forward
+inline void advance(uint64_t us) { clock_us() += us; }
+
+}  // namespace MSFHost
+
+inline uint32_t micros() {
+  MSFHost::advance(MSFHost::call_cost_us());
+  return (uint32_t)MSFHost::clock_us();
+}
+
+inline uint32_t millis() {
+  MSFHost::advance(MSFHost::call_cost_us());
+  return (uint32_t)(MSFHost::clock_us() / 1000);
+}
+
+inline void delay(uint32_t ms) { MSFHost::advance(ms * 1000ULL); }
+inline void delayMicroseconds(uint32_t us) { MSFHost::advance(us); }
+inline void yield() {}
+
+inline void randomSeed(unsigned long seed) { srand(seed); }
+inline long random(long max) { return max > 0 ? rand() % max : 0; }
+inline long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+
+/// @brief Serial that prints to stdout, numbers are printed the way Arduino
+/// does it (uint8_t is a number, not a character)
+class HostSerial {
+  static void printNumber(unsigned long long value, int base) {
+    char digits[65];
+    int len = 0;
+    do {
+      int digit = value % base;
+      digits[len++] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+      value /= base;
+    } while (value > 0);
+    while (len > 0) putchar(digits[--len]);
+  }
+
+  static void printSigned(long long value, int base) {
+    if (value < 0 && base == DEC) {
+      putchar('-');
+      printNumber(-value, base);
+    } else {
+      printNumber((unsigned long long)value, base);
+    }
+  }
+
+ public:
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+
+  void print(const char* text) { fputs(text, stdout); }
+  void print(char c) { putchar(c); }
+  void print(unsigned char value, int base = DEC) { printNumber(value, base); }
+  void print(int value, int base = DEC) { printSigned(value, base); }
+  void print(unsigned int value, int base = DEC) { printNumber(value, base); }
+  void print(long value, int base = DEC) { printSigned(value, base); }
+  void print(unsigned long value, int base = DEC) { printNumber(value, base); }
+  void print(long long value, int base = DEC) { printSigned(value, base); }
+  void print(unsigned long long value, int base = DEC) { printNumber(value, base); }
+  void print(double value, int digits = 2) { printf("%.*f", digits, value); }
+
+  void println() { putchar('\n'); }
+  template <class T>
+  void println(T value) {
+    this->print(value);
+    this->println();
+  }
+  template <class T>
+  void println(T value, int format) {
+    this->print(value, format);
+    this->println();
+  }
+};
+
+static HostSerial Serial __attribute__((unused));
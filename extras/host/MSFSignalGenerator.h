@@ -0,0 +1,233 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <MSFData.h>
+#include <MSFFrame.h>
+#include <MSFProtocol.h>
+
+#include <vector>
+
+#include "MSFTraceReplay.h"
+
+/// @brief Generates the carrier of an MSF transmitter as the receiver module
+/// would see it, with noise, edge jitter, clock drift and fades that can be
+/// set on the fly. Every frame is built by MSFFrame::encode(), so the signal
+/// follows whatever the decoder expects from the spec. DCF77, WWVB and JJY
+/// frames come from the encode() of their protocol, see MSFProtocol.h, the
+/// call sign JJY sends at minutes 15 and 45 is not simulated.
+///
+/// Signal time is counted from the start of the first frame. Frame k carries
+/// startTime plus k minutes, which is the time of the minute starting at the
+/// end of the frame.
+class MSFSignalGenerator {
+  static const uint64_t MINUTE_US = 60000000ULL;
+  static const uint64_t SECOND_US = 1000000ULL;
+
+  MSFFrame frame;
+  uint64_t frameIdx = UINT64_MAX;
+
+  /// @brief Returns a pseudo random number for given values, the same every
+  /// time so repeated reads of the same edge see the same jitter
+  static uint32_t hash(uint64_t a, uint32_t b) {
+    uint64_t h = (a * 0x9E3779B97F4A7C15ULL) ^ (b * 0xC2B2AE3D27D4EB4FULL);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return (uint32_t)h;
+  }
+
+  /// @brief Returns jitter of given edge in microseconds
+  /// @param second Seconds since the start of the signal
+  /// @param edge Edge of the second, 0 to 3 for 0ms, 100ms, 200ms and 300ms
+  int32_t jitter(uint64_t second, uint32_t edge) const {
+    if (this->jitterUs == 0) return 0;
+    return (int32_t)(hash(second, edge) % (2 * this->jitterUs + 1)) - (int32_t)this->jitterUs;
+  }
+
+  /// @brief Makes sure frame holds given frame of the signal
+  void loadFrame(uint64_t idx) {
+    if (idx == this->frameIdx) return;
+    this->frameIdx = idx;
+    MSFData time = this->minute_time(idx);
+    switch (this->protocol) {
+      case Protocol::DCF77:
+        DCF77Protocol<>::encode(time, this->frame);
+        break;
+      case Protocol::WWVB:
+        WWVBProtocol<>::encode(time, this->frame);
+        break;
+      case Protocol::JJY:
+        JJYProtocol<>::encode(time, this->frame);
+        break;
+      default:
+        this->frame.encode(time);
+        break;
+    }
+  }
+
+  /// @brief Returns how long the pulse at the start of given second lasts in
+  /// milliseconds, for the signals that send a single pulse per second
+  /// @param second Seconds since the start of the signal
+  uint32_t pulseMs(uint64_t second) {
+    this->loadFrame(second / 60);
+    int secondOfMinute = second % 60;
+    bool a = this->frame.a(secondOfMinute);
+    bool marker = this->frame.b(secondOfMinute);
+    switch (this->protocol) {
+      case Protocol::DCF77:
+        if (secondOfMinute == 59) return 0;
+        return a ? 200 : 100;
+      case Protocol::WWVB:
+        return marker ? 800 : a ? 500 : 200;
+      default:
+        return marker ? 200 : a ? 500 : 800;
+    }
+  }
+
+ public:
+  /// @brief Time signals the generator can transmit
+  enum class Protocol { MSF, DCF77, WWVB, JJY };
+
+  // time signal to transmit, set before the first read
+  Protocol protocol = Protocol::MSF;
+  // time carried by the first frame
+  MSFData startTime;
+  // local clock (micros()) time at which the first frame starts, there is no
+  // signal before it and the reads see just carrier
+  uint64_t startUs = 0;
+  // share of reads flipped by noise (0 to 1)
+  double noise = 0;
+  // every edge is moved by up to this many microseconds either way
+  uint32_t jitterUs = 0;
+  // how much faster the local clock runs than the transmitter, in ppm
+  double driftPpm = 0;
+  // every fadeEverySeconds the signal fades for fadeSeconds, reading random
+  // noise as most receiver modules do without signal
+  uint32_t fadeEverySeconds = 0;
+  uint32_t fadeSeconds = 0;
+
+  /// @brief Starts with 2024-05-17 13:30, a Friday, with no DUT1 or summer
+  /// time
+  MSFSignalGenerator() {
+    this->startTime.year = 2024;
+    this->startTime.month = 5;
+    this->startTime.day = 17;
+    this->startTime.dayOfTheWeek = 6;
+    this->startTime.hour = 13;
+    this->startTime.minute = 30;
+    this->startTime.checksumPassed = true;
+  }
+
+  /// @brief Returns the time carried by given frame
+  /// @param idx Index of the frame, 0 is the first one
+  MSFData minute_time(uint64_t idx) const {
+    MSFData time = this->startTime;
+    time.add_minutes(idx);
+    return time;
+  }
+
+  /// @brief Converts local clock time to signal time
+  uint64_t to_signal_time(uint64_t localUs) const {
+    if (localUs < this->startUs) return 0;
+    return (uint64_t)((localUs - this->startUs) / (1.0 + this->driftPpm * 1e-6));
+  }
+
+  /// @brief Converts signal time to local clock time, the opposite of
+  /// to_signal_time()
+  uint64_t to_local_time(uint64_t signalUs) const {
+    return this->startUs + (uint64_t)(signalUs * (1.0 + this->driftPpm * 1e-6));
+  }
+
+  /// @brief Returns the time that starts at given local clock time, that is
+  /// the time carried by the frame before the next minute edge
+  /// @param localUs Local clock time
+  /// @param minuteEdgeUs Output, local clock time of that minute edge
+  MSFData time_after(uint64_t localUs, uint64_t& minuteEdgeUs) const {
+    uint64_t idx = this->to_signal_time(localUs) / MINUTE_US;
+    minuteEdgeUs = this->to_local_time((idx + 1) * MINUTE_US);
+    return this->minute_time(idx);
+  }
+
+  /// @brief Returns the clean carrier state at given signal time, without
+  /// noise or fades
+  /// @param signalUs Signal time in microseconds
+  bool carrier_at(uint64_t signalUs) {
+    uint64_t second = signalUs / SECOND_US;
+    int32_t inSecond = signalUs % SECOND_US;
+    if (this->protocol != Protocol::MSF) {
+      // the pulse is the carrier going off, or on for JJY which runs at
+      // reduced power in between
+      bool pulse = this->protocol == Protocol::JJY;
+      if (inSecond >= (int32_t)SECOND_US + this->jitter(second + 1, 0))
+        return this->pulseMs(second + 1) > 0 ? pulse : !pulse;
+      if (inSecond < this->jitter(second, 0)) return !pulse;
+      uint32_t length = this->pulseMs(second);
+      if (length > 0 && inSecond < (int32_t)(length * 1000) + this->jitter(second, 1)) return pulse;
+      return !pulse;
+    }
+
+    // the end of this second is the start of the next one, which can be
+    // jittered back into this one
+    if (inSecond >= (int32_t)SECOND_US + this->jitter(second + 1, 0)) return false;
+    if (inSecond < this->jitter(second, 0)) return true;
+
+    this->loadFrame(second / 60);
+    int secondOfMinute = second % 60;
+    if (secondOfMinute == 0) return inSecond >= 500000 + this->jitter(second, 1);
+    if (inSecond < 100000 + this->jitter(second, 1)) return false;
+    if (inSecond < 200000 + this->jitter(second, 2)) return !this->frame.a(secondOfMinute);
+    if (inSecond < 300000 + this->jitter(second, 3)) return !this->frame.b(secondOfMinute);
+    return true;
+  }
+
+  /// @brief Returns what the receiver module outputs at given local clock
+  /// time, noise and fades included
+  /// @param localUs Local clock time in microseconds
+  bool read_at(uint64_t localUs) {
+    if (localUs < this->startUs) return true;
+    uint64_t signalUs = this->to_signal_time(localUs);
+    if (this->fadeEverySeconds > 0 &&
+        signalUs / SECOND_US % this->fadeEverySeconds < this->fadeSeconds)
+      return rand() & 1;
+    bool carrier = this->carrier_at(signalUs);
+    if (this->noise > 0 && rand() < this->noise * RAND_MAX) carrier = !carrier;
+    return carrier;
+  }
+
+  /// @brief Returns what the receiver module outputs right now
+  bool read() { return this->read_at(MSFHost::clock_us()); }
+
+  /// @brief Records the receiver module output from startUs on, sampled every
+  /// MSFTraceFormat::UNIT_US, so it can be played back by MSFTraceReplay
+  /// @param durationUs How long to record in microseconds
+  /// @return Trace in MSFTraceFormat
+  std::vector<uint8_t> record_trace(uint64_t durationUs) {
+    std::vector<uint8_t> trace(MSFTraceFormat::MAGIC, MSFTraceFormat::MAGIC + 4);
+    trace.push_back(MSFTraceFormat::VERSION);
+    bool state = this->read_at(this->startUs);
+    trace.push_back(state);
+
+    // the run in progress is written out once the state flips, after the last
+    // unit we pretend it does
+    uint64_t runLength = 0;
+    uint64_t units = durationUs / MSFTraceFormat::UNIT_US;
+    for (uint64_t unit = 0; unit <= units; unit++) {
+      bool carrier = unit < units
+                         ? this->read_at(this->startUs + unit * MSFTraceFormat::UNIT_US)
+                         : !state;
+      if (carrier == state) {
+        runLength++;
+        continue;
+      }
+      do {
+        uint8_t byte = runLength & 0x7F;
+        runLength >>= 7;
+        trace.push_back(runLength > 0 ? byte | 0x80 : byte);
+      } while (runLength > 0);
+      state = carrier;
+      runLength = 1;
+    }
+    return trace;
+  }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MSFTraceFormat.h>
+
+#include <vector>
+
+/// @brief Plays a recorded carrier trace back as the receiver module output.
+/// The time runs on the virtual clock of the host, so a trace of minutes
+/// replays in milliseconds. After the end of the trace the last state stays.
+class MSFTraceReplay {
+  std::vector<uint8_t> trace;
+  bool valid = false;
+  bool startCarrier = true;
+  uint64_t totalUs = 0;
+
+  // where we are in the trace, reads mostly move forward so we keep going
+  // from the run we found last time
+  size_t cursor;
+  uint64_t runStartUs;
+  uint64_t runEndUs;
+  bool runCarrier;
+
+  /// @brief Reads LEB128 number at given position of the trace
+  /// @param pos Position, moved past the number
+  /// @param value Output, the number
+  /// @return False if the trace ends in the middle of the number
+  bool readLength(size_t& pos, uint64_t& value) const {
+    value = 0;
+    for (int shift = 0; pos < this->trace.size() && shift < 64; shift += 7) {
+      uint8_t byte = this->trace[pos++];
+      value |= (uint64_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+
+  /// @brief Goes back to the first run of the trace
+  void rewind() {
+    this->cursor = MSFTraceFormat::HEADER_SIZE;
+    this->runStartUs = 0;
+    this->runCarrier = this->startCarrier;
+    uint64_t length = 0;
+    if (!this->readLength(this->cursor, length)) length = UINT64_MAX / 2;
+    this->runEndUs = length * MSFTraceFormat::UNIT_US;
+  }
+
+  /// @brief Moves to the next run, the last one never ends
+  void nextRun() {
+    uint64_t length;
+    this->runStartUs = this->runEndUs;
+    this->runCarrier = !this->runCarrier;
+    if (this->readLength(this->cursor, length))
+      this->runEndUs += length * MSFTraceFormat::UNIT_US;
+    else
+      this->runEndUs = UINT64_MAX;
+  }
+
+ public:
+  // local clock (micros()) time at which the trace starts
+  uint64_t startUs = 0;
+
+  /// @brief Takes the trace from memory
+  /// @param data Trace in MSFTraceFormat
+  /// @param size Size of the trace in bytes
+  /// @return False if it is not a trace we can play
+  bool load(const uint8_t* data, size_t size) {
+    this->trace.assign(data, data + size);
+    this->valid = size >= MSFTraceFormat::HEADER_SIZE &&
+                  memcmp(data, MSFTraceFormat::MAGIC, 4) == 0 &&
+                  data[4] == MSFTraceFormat::VERSION;
+    if (!this->valid) return false;
+    this->startCarrier = data[5] != 0;
+
+    this->totalUs = 0;
+    size_t pos = MSFTraceFormat::HEADER_SIZE;
+    uint64_t length;
+    while (this->readLength(pos, length)) this->totalUs += length * MSFTraceFormat::UNIT_US;
+    this->rewind();
+    return true;
+  }
+
+  /// @brief Reads the trace from a file
+  /// @param path Path of the file
+  /// @return False if the file can not be read or is not a trace we can play
+  bool load_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      data.insert(data.end(), buffer, buffer + len);
+    fclose(file);
+    return this->load(data.data(), data.size());
+  }
+
+  /// @brief Checks a trace was loaded
+  bool is_valid() const { return this->valid; }
+
+  /// @brief Returns how long the trace is in microseconds
+  uint64_t get_duration_us() const { return this->totalUs; }
+
+  /// @brief Returns the carrier state at given time of the trace
+  /// @param traceUs Time since the start of the trace in microseconds
+  bool carrier_at(uint64_t traceUs) {
+    if (!this->valid) return true;
+    if (traceUs < this->runStartUs) this->rewind();
+    while (traceUs >= this->runEndUs) this->nextRun();
+    return this->runCarrier;
+  }
+
+  /// @brief Returns what the receiver module output right now, the trace is
+  /// played from startUs on
+  bool read() {
+    uint64_t now = MSFHost::clock_us();
+    return this->carrier_at(now > this->startUs ? now - this->startUs : 0);
+  }
+};
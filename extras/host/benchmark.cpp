@@ -0,0 +1,255 @@
+// Benchmarks MSFReceiver on a PC against the simulated signal, see the
+// "Simulation on a PC" section of README for how to build it.
+//
+//   ./msf_benchmark [trials]
+//
+// It reports:
+// - time to first fix of get_time_with_retry() at several noise levels, mean
+//   and 95th percentile over the trials (20 by default)
+// - share of minutes decoded in tracking mode at the same noise levels
+// - host time and cycles spent per carrier sample while syncing (rolling
+//   buffer and candidates) and while acquiring bits, for several receivers and
+//   for a reader policy against the reader function
+//
+// Noise is the share of carrier reads flipped. For a receiver module that
+// slices a signal with gaussian noise that is Q(sqrt(SNR)), which is how the
+// SNR column is calculated.
+//
+// The cost per sample includes reading the clocks around every tick, a few
+// tens of ns. The numbers are for the host CPU, not the MCU. Use them to compare
+// receivers and to catch regressions between releases, run on the same
+// machine.
+
+#include <Arduino.h>
+#include <MSF-Time-Lib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#else
+#define HAVE_CYCLES 0
+#endif
+
+#include "MSFSignalGenerator.h"
+#include "MSFTraceReplay.h"
+
+static const uint64_t MINUTE_US = 60000000ULL;
+// get_time_with_retry() never gives up, so after this the noise goes away and
+// the trial is counted as failed
+static const uint64_t GIVE_UP_US = 30 * MINUTE_US;
+static const double NOISE_LEVELS[] = {0, 0.02, 0.05, 0.1, 0.16, 0.2, 0.25};
+
+static MSFSignalGenerator generator;
+static MSFTraceReplay replay;
+static uint64_t reads = 0;
+static uint64_t giveUpAt = 0;
+static double trialNoise = 0;
+
+static bool readGenerator() {
+  generator.noise = MSFHost::clock_us() < giveUpAt ? trialNoise : 0;
+  return generator.read();
+}
+
+static bool readReplay() {
+  reads++;
+  return replay.read();
+}
+
+/// @brief Reader policy playing the trace, readReplay() without the call
+/// through a pointer
+struct ReplayReader {
+  static const uint8_t INPUTS = 1;
+
+  static uint8_t read() { return readReplay(); }
+};
+
+using PolicyReceiver = MSFReceiver<1, MSFBitWindows<>, 1, MSF_TIME_LIB_OBSERVER, ReplayReader>;
+
+/// @brief Receiver reading the trace, through readReplay() unless it has a
+/// reader policy of its own
+template <class RECEIVER>
+struct ReplayReceiver : RECEIVER {
+  ReplayReceiver() : RECEIVER(readReplay) {}
+};
+
+template <>
+struct ReplayReceiver<PolicyReceiver> : PolicyReceiver {};
+
+static uint64_t cycles() {
+#if HAVE_CYCLES
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/// @brief Returns SNR in dB at which a slicer flips given share of reads
+static double snrForNoise(double noise) {
+  if (noise <= 0) return INFINITY;
+  // Q(x) = erfc(x / sqrt(2)) / 2 falls with x, find where it is the noise
+  double low = 0, high = 10;
+  for (int i = 0; i < 60; i++) {
+    double mid = (low + high) / 2;
+    if (erfc(mid / sqrt(2.0)) / 2 > noise)
+      low = mid;
+    else
+      high = mid;
+  }
+  return 20 * log10(low);
+}
+
+/// @brief Starts a trial at random point of the minute of the generated signal
+static void startTrial(double noise) {
+  MSFHost::clock_us() = 0;
+  generator.startUs = 0;
+  MSFHost::advance(MINUTE_US + rand() % MINUTE_US);
+  trialNoise = noise;
+  giveUpAt = MSFHost::clock_us() + GIVE_UP_US;
+}
+
+static void benchmarkTimeToFix(int trials) {
+  printf("time to first fix, get_time_with_retry(), %d trials\n", trials);
+  printf("  noise   SNR      mean     p95  failed  wrong\n");
+  for (double noise : NOISE_LEVELS) {
+    std::vector<double> fixTimes;
+    int failed = 0, wrong = 0;
+    for (int trial = 0; trial < trials; trial++) {
+      startTrial(noise);
+      uint64_t startedAt = MSFHost::clock_us();
+      MSFReceiver<1> msf(readGenerator);
+      MSFData decoded = msf.get_time_with_retry();
+      uint64_t minuteEdge;
+      MSFData expected = generator.time_after(MSFHost::clock_us(), minuteEdge);
+      if (decoded.minute != expected.minute || decoded.hour != expected.hour ||
+          decoded.day != expected.day || decoded.month != expected.month ||
+          decoded.year != expected.year)
+        wrong++;
+      else if (MSFHost::clock_us() >= giveUpAt)
+        failed++;
+      else
+        fixTimes.push_back((MSFHost::clock_us() - startedAt) / 1e6);
+    }
+    std::sort(fixTimes.begin(), fixTimes.end());
+    double mean = 0;
+    for (double fixTime : fixTimes) mean += fixTime;
+    if (!fixTimes.empty()) mean /= fixTimes.size();
+    double p95 = fixTimes.empty() ? 0 : fixTimes[(fixTimes.size() * 95 - 1) / 100];
+    printf("  %5.2f %5.1fdB %7.1fs %6.1fs %7d %6d\n", noise, snrForNoise(noise), mean, p95, failed,
+           wrong);
+  }
+}
+
+static void benchmarkYield(int minutes) {
+  printf("minutes decoded in tracking mode, %d minutes\n", minutes);
+  printf("  noise   SNR  decoded  wrong\n");
+  for (double noise : NOISE_LEVELS) {
+    startTrial(noise);
+    giveUpAt = UINT64_MAX;
+    uint64_t endAt = MSFHost::clock_us() + minutes * MINUTE_US;
+    MSFReceiver<1> msf(readGenerator);
+    msf.start_tracking();
+    int good = 0, wrong = 0;
+    while (MSFHost::clock_us() < endAt) {
+      if (msf.tick() && msf.get_result().checksumPassed) {
+        const MSFData& decoded = msf.get_result();
+        uint64_t minuteEdge;
+        MSFData expected = generator.time_after(MSFHost::clock_us(), minuteEdge);
+        if (decoded.minute == expected.minute && decoded.hour == expected.hour &&
+            decoded.day == expected.day)
+          good++;
+        else
+          wrong++;
+      }
+      uint32_t wait = msf.get_time_until_next_event();
+      if (wait > 0) MSFHost::advance(wait);
+    }
+    printf("  %5.2f %5.1fdB %6.0f%% %6d\n", noise, snrForNoise(noise), 100.0 * good / minutes,
+           wrong);
+  }
+}
+
+struct TickCost {
+  uint64_t ns = 0;
+  uint64_t cycles = 0;
+  uint64_t reads = 0;
+
+  void add(uint64_t tickNs, uint64_t tickCycles, uint64_t tickReads) {
+    this->ns += tickNs;
+    this->cycles += tickCycles;
+    this->reads += tickReads;
+  }
+
+  void print() const {
+    printf(" %8.1fns %8.0f", this->reads ? (double)this->ns / this->reads : 0.0,
+           this->reads ? (double)this->cycles / this->reads : 0.0);
+  }
+};
+
+// ticks taking longer than this were interrupted by the OS, they are left out
+static const uint64_t PREEMPTED_NS = 50000;
+
+/// @brief Measures host time and cycles per carrier sample while syncing and
+/// while acquiring. The signal is played from a trace, so the reader costs
+/// next to nothing and we measure the receiver alone. The first run warms the
+/// caches up and is not printed.
+template <class RECEIVER>
+void benchmarkCost(const char* name, const std::vector<uint8_t>& trace, bool print = true) {
+  if (print) benchmarkCost<RECEIVER>(name, trace, false);
+  replay.load(trace.data(), trace.size());
+  replay.startUs = 0;
+  MSFHost::clock_us() = 0;
+  MSFHost::advance(MINUTE_US / 3);
+
+  ReplayReceiver<RECEIVER> msf;
+  msf.start();
+  TickCost sync, acquire;
+  while (MSFHost::clock_us() < replay.get_duration_us()) {
+    MSFState state = msf.get_state();
+    uint64_t readsBefore = reads;
+    auto hostStart = std::chrono::steady_clock::now();
+    uint64_t cyclesStart = cycles();
+    bool done = msf.tick();
+    uint64_t tickCycles = cycles() - cyclesStart;
+    uint64_t tickNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - hostStart)
+                          .count();
+    if (tickNs < PREEMPTED_NS) {
+      if (state == MSFState::SYNC) sync.add(tickNs, tickCycles, reads - readsBefore);
+      if (state == MSFState::ACQUIRE) acquire.add(tickNs, tickCycles, reads - readsBefore);
+    }
+    if (done) break;
+    uint32_t wait = msf.get_time_until_next_event();
+    if (wait > 0) MSFHost::advance(wait);
+  }
+
+  if (!print) return;
+  printf("  %-24s", name);
+  sync.print();
+  acquire.print();
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  int trials = argc > 1 ? atoi(argv[1]) : 20;
+  srand(1);
+
+  benchmarkTimeToFix(trials);
+  benchmarkYield(60);
+
+  generator.noise = 0;
+  generator.startUs = 0;
+  std::vector<uint8_t> trace = generator.record_trace(4 * MINUTE_US);
+  printf("cost per carrier sample%s\n", HAVE_CYCLES ? "" : " (no cycle counter here)");
+  printf("  %-24s %10s %8s %10s %8s\n", "receiver", "sync", "cycles", "acquire", "cycles");
+  benchmarkCost<MSFReceiver<1>>("MSFReceiver<1>", trace);
+  benchmarkCost<MSFReceiver<2>>("MSFReceiver<2>", trace);
+  benchmarkCost<MSFReceiver<5>>("MSFReceiver<5>", trace);
+  benchmarkCost<MSFReceiver<10>>("MSFReceiver<10>", trace);
+  benchmarkCost<MSFReceiver<1, MSFBitWindows<>, 10>>("MSFReceiver<1, ..., 10>", trace);
+  benchmarkCost<PolicyReceiver>("MSFReceiver<1> policy", trace);
+  return 0;
+}
@@ -0,0 +1,297 @@
+// Runs MSFReceiver against a simulated or recorded signal on a PC, see the
+// "Simulation on a PC" section of README for how to build it.
+//
+//   ./msf_simulate [options]
+//
+//   --protocol NAME     time signal to generate and decode, msf, dcf77, wwvb
+//                       or jjy (msf)
+//   --trials N          number of acquisitions to run (10)
+//   --minutes N         give up an acquisition after this many minutes (10)
+//   --tracking          stay in tracking mode and count decoded minutes
+//   --noise P           share of reads flipped by noise, 0 to 1 (0)
+//   --jitter US         move every edge by up to US microseconds (0)
+//   --drift PPM         local clock runs this much faster than MSF (0)
+//   --fade EVERY,LEN    fade for LEN seconds every EVERY seconds (off)
+//   --seed N            seed of the random numbers (1)
+//   --block US          sample every US microseconds into MSFSampleBuffer, the
+//                       way a timer would, and tick once per block
+//   --trace FILE        replay a recorded trace instead of the generator
+//   --write-trace FILE  record --minutes of the generated signal and exit
+//   --record-trace FILE record what the receiver reads in the first trial
+//                       with MSFTraceRecorder, the way a device would
+
+#include <Arduino.h>
+#include <MSF-Time-Lib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "MSFSignalGenerator.h"
+#include "MSFTraceReplay.h"
+
+static MSFSignalGenerator generator;
+static MSFTraceReplay replay;
+static bool replaying = false;
+static uint64_t reads = 0;
+
+// small on purpose, it is flushed into the file after every tick
+static uint8_t recorderBuffer[256];
+static MSFTraceRecorder recorder(recorderBuffer, sizeof(recorderBuffer));
+
+/// @brief Stream the recorder flushes into
+struct TraceFile {
+  FILE* file = nullptr;
+  size_t write(const uint8_t* data, size_t size) { return fwrite(data, 1, size, this->file); }
+};
+static TraceFile recordedTrace;
+
+static bool readSignal() {
+  reads++;
+  bool carrier = replaying ? replay.read() : generator.read();
+  recorder.record((uint32_t)MSFHost::clock_us(), carrier);
+  return carrier;
+}
+
+struct Options {
+  int trials = 10;
+  int minutes = 10;
+  bool tracking = false;
+  unsigned seed = 1;
+  const char* trace = nullptr;
+  const char* writeTrace = nullptr;
+  const char* recordTrace = nullptr;
+  uint32_t blockUs = 0;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--tracking")) {
+      options.tracking = true;
+      continue;
+    }
+    if (value == nullptr) return false;
+    i++;
+    if (!strcmp(arg, "--protocol")) {
+      if (!strcmp(value, "msf"))
+        generator.protocol = MSFSignalGenerator::Protocol::MSF;
+      else if (!strcmp(value, "dcf77"))
+        generator.protocol = MSFSignalGenerator::Protocol::DCF77;
+      else if (!strcmp(value, "wwvb"))
+        generator.protocol = MSFSignalGenerator::Protocol::WWVB;
+      else if (!strcmp(value, "jjy"))
+        generator.protocol = MSFSignalGenerator::Protocol::JJY;
+      else
+        return false;
+    } else if (!strcmp(arg, "--trials"))
+      options.trials = atoi(value);
+    else if (!strcmp(arg, "--minutes"))
+      options.minutes = atoi(value);
+    else if (!strcmp(arg, "--noise"))
+      generator.noise = atof(value);
+    else if (!strcmp(arg, "--jitter"))
+      generator.jitterUs = atoi(value);
+    else if (!strcmp(arg, "--drift"))
+      generator.driftPpm = atof(value);
+    else if (!strcmp(arg, "--fade"))
+      sscanf(value, "%u,%u", &generator.fadeEverySeconds, &generator.fadeSeconds);
+    else if (!strcmp(arg, "--block"))
+      options.blockUs = atoi(value);
+    else if (!strcmp(arg, "--seed"))
+      options.seed = atoi(value);
+    else if (!strcmp(arg, "--trace"))
+      options.trace = value;
+    else if (!strcmp(arg, "--write-trace"))
+      options.writeTrace = value;
+    else if (!strcmp(arg, "--record-trace"))
+      options.recordTrace = value;
+    else
+      return false;
+  }
+  return true;
+}
+
+/// @brief Records the generated signal into a file, so it can be played
+/// back with --trace
+static bool writeTrace(const char* path, int minutes) {
+  std::vector<uint8_t> trace = generator.record_trace(minutes * 60000000ULL);
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) return false;
+  fwrite(trace.data(), 1, trace.size(), file);
+  fclose(file);
+  printf("wrote %u bytes\n", (unsigned)trace.size());
+  return true;
+}
+
+/// @brief Samples the signal the way a timer interrupt would, until the next
+/// block of the sample buffer is complete
+static void sampleBlock(MSFSampleBuffer& samples, uint32_t periodUs) {
+  uint32_t before = 0, after = 0;
+  samples.get_end(before);
+  do {
+    // the module pulls the pin low with carrier
+    samples.push_sample(!readSignal());
+    MSFHost::advance(periodUs);
+  } while ((!samples.get_end(after) || after == before) && !samples.check_and_clear_overflow());
+}
+
+/// @brief Checks the decoded time is the time the signal carried, we dont
+/// know that for a trace so there we just print it
+/// @param edgeError Output, how far minuteEdgeMicros is from the real minute
+/// edge in microseconds, 0 for a trace
+static bool isCorrect(const MSFData& decoded, uint64_t now, int32_t& edgeError) {
+  edgeError = 0;
+  if (replaying) {
+    printf("decoded %04u-%02u-%02u %02u:%02u\n", (unsigned)decoded.year, decoded.month,
+           decoded.day, decoded.hour, decoded.minute);
+    return true;
+  }
+  uint64_t minuteEdge;
+  MSFData expected = generator.time_after(now, minuteEdge);
+  edgeError = (int32_t)(decoded.minuteEdgeMicros - (uint32_t)minuteEdge);
+  return decoded.year == expected.year && decoded.month == expected.month &&
+         decoded.day == expected.day && decoded.hour == expected.hour &&
+         decoded.minute == expected.minute;
+}
+
+struct Results {
+  std::vector<double> fixTimes;
+  // error of minuteEdgeMicros of the correct minutes
+  std::vector<double> edgeErrors;
+  int wrong = 0, failed = 0, decodedMinutes = 0, goodMinutes = 0;
+  double hostSeconds = 0, simulatedSeconds = 0;
+};
+
+/// @brief Runs one acquisition with a receiver of given protocol
+template <class PROTOCOL>
+static void runTrial(const Options& options, Results& results) {
+  // every trial starts at a random point of the minute, a trace always
+  // plays from its start
+  MSFHost::clock_us() = 0;
+  generator.startUs = 0;
+  replay.startUs = 0;
+  if (!replaying) MSFHost::advance(60000000ULL + rand() % 60000000ULL);
+  uint64_t startedAt = MSFHost::clock_us();
+  uint64_t giveUpAt = startedAt + options.minutes * 60000000ULL;
+
+  MSFSampleBuffer samples(options.blockUs);
+  using Receiver = MSFReceiver<1, PROTOCOL>;
+  Receiver msf = options.blockUs ? Receiver(samples) : Receiver(readSignal);
+  if (options.tracking)
+    msf.start_tracking();
+  else
+    msf.start();
+
+  bool fixed = false;
+  auto hostStart = std::chrono::steady_clock::now();
+  while (MSFHost::clock_us() < giveUpAt) {
+    bool ticked = msf.tick();
+    if (recordedTrace.file) recorder.flush(recordedTrace);
+    if (ticked) {
+      const MSFData& result = msf.get_result();
+      int32_t edgeError;
+      bool correct =
+          result.checksumPassed && isCorrect(result, MSFHost::clock_us(), edgeError);
+      if (correct) results.edgeErrors.push_back(edgeError < 0 ? -edgeError : edgeError);
+      if (result.checksumPassed && !correct) results.wrong++;
+      results.decodedMinutes++;
+      if (correct) results.goodMinutes++;
+      if (correct && !fixed) {
+        fixed = true;
+        results.fixTimes.push_back((MSFHost::clock_us() - startedAt) / 1e6);
+      }
+      if (!options.tracking) {
+        if (result.checksumPassed) break;
+        msf.start();
+      }
+    }
+    if (options.blockUs) {
+      sampleBlock(samples, options.blockUs);
+      continue;
+    }
+    uint32_t wait = msf.get_time_until_next_event();
+    if (wait > 0) MSFHost::advance(wait);
+  }
+  results.hostSeconds +=
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+  results.simulatedSeconds += (MSFHost::clock_us() - startedAt) / 1e6;
+  if (!fixed) results.failed++;
+  if (recorder.is_recording()) recorder.stop((uint32_t)MSFHost::clock_us());
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "unknown option, see the top of simulate.cpp\n");
+    return 2;
+  }
+  srand(options.seed);
+  if (options.writeTrace) return writeTrace(options.writeTrace, options.minutes) ? 0 : 1;
+  if (options.trace) {
+    if (!replay.load_file(options.trace)) {
+      fprintf(stderr, "can not read trace %s\n", options.trace);
+      return 1;
+    }
+    replaying = true;
+    // a recorded trace rarely ends on a whole minute, its last one counts
+    uint64_t traceMinutes = (replay.get_duration_us() + 59999999ULL) / 60000000ULL;
+    options.minutes = std::min<uint64_t>(options.minutes, traceMinutes);
+  }
+  if (options.recordTrace) {
+    recordedTrace.file = fopen(options.recordTrace, "wb");
+    if (recordedTrace.file == nullptr) {
+      fprintf(stderr, "can not write trace %s\n", options.recordTrace);
+      return 1;
+    }
+    recorder.start();
+  }
+
+  Results results;
+  for (int trial = 0; trial < options.trials; trial++) {
+    switch (generator.protocol) {
+      case MSFSignalGenerator::Protocol::DCF77:
+        runTrial<DCF77Protocol<>>(options, results);
+        break;
+      case MSFSignalGenerator::Protocol::WWVB:
+        runTrial<WWVBProtocol<>>(options, results);
+        break;
+      case MSFSignalGenerator::Protocol::JJY:
+        runTrial<JJYProtocol<>>(options, results);
+        break;
+      default:
+        runTrial<MSFProtocol<>>(options, results);
+        break;
+    }
+  }
+
+  std::sort(results.fixTimes.begin(), results.fixTimes.end());
+  double meanFix = 0;
+  for (double fixTime : results.fixTimes) meanFix += fixTime;
+  if (!results.fixTimes.empty()) meanFix /= results.fixTimes.size();
+
+  printf("trials %d, fixed %d, failed %d, wrong %d\n", options.trials, (int)results.fixTimes.size(),
+         results.failed, results.wrong);
+  if (!results.fixTimes.empty())
+    printf("time to first fix: mean %.1fs, min %.1fs, max %.1fs\n", meanFix,
+           results.fixTimes.front(), results.fixTimes.back());
+  if (options.tracking)
+    printf("minutes decoded: %d of %d\n", results.goodMinutes, results.decodedMinutes);
+  if (!results.edgeErrors.empty() && !replaying) {
+    std::sort(results.edgeErrors.begin(), results.edgeErrors.end());
+    double meanEdgeError = 0;
+    for (double edgeError : results.edgeErrors) meanEdgeError += edgeError;
+    meanEdgeError /= results.edgeErrors.size();
+    printf("minute edge error: mean %.0fus, 95th percentile %.0fus, max %.0fus\n", meanEdgeError,
+           results.edgeErrors[results.edgeErrors.size() * 95 / 100], results.edgeErrors.back());
+  }
+  printf("reads per simulated second: %.0f\n", reads / results.simulatedSeconds);
+  printf("simulated %.0fs in %.2fs of host time\n", results.simulatedSeconds, results.hostSeconds);
+  if (recordedTrace.file) {
+    recorder.flush(recordedTrace);
+    printf("recorded %ld bytes\n", ftell(recordedTrace.file));
+    fclose(recordedTrace.file);
+  }
+  return 0;
+}
@@ -1,98 +1,373 @@
+#pragma once
+
 #include <Arduino.h>
 
-#if MSF_TIME_LIB_DEBUG
-#define MSF_TIME_LIB_LOG(...) Serial.print(__VA_ARGS__)
-#define MSF_TIME_LIB_LOGLN(...) Serial.println(__VA_ARGS__)
-#else
-#define MSF_TIME_LIB_LOG(...)
-#define MSF_TIME_LIB_LOGLN(...)
-#endif
+#include "MSFBitThreshold.h"
+#include "MSFClock.h"
+#include "MSFData.h"
+#include "MSFDiversity.h"
+#include "MSFEdgeBuffer.h"
+#include "MSFEdgeFit.h"
+#include "MSFFrame.h"
+#include "MSFLockState.h"
+#include "MSFLowPower.h"
+#include "MSFObserver.h"
+#include "MSFProtocol.h"
+#include "MSFReader.h"
+#include "MSFSampleBuffer.h"
+#include "MSFSoftAccumulator.h"
+#include "MSFState.h"
+#include "MSFSyncCandidates.h"
+#include "MSFTask.h"
+#include "MSFTimeCode.h"
+#include "MSFTraceRecorder.h"
 
-struct MSFData {
-  uint32_t year = 2000;  // MSF time spec gives year in 00 to 99 range, whoever maintains this in
-                         // 2100 can change it :P
-  uint8_t month;
-  uint8_t day;
-  uint8_t hour;
-  uint8_t minute;
-  const uint8_t second = 0;  // MSF signal does not transmit seconds, we know its 0 because of how
-                             // we are syncing to the minute marker transition
-  uint8_t dayOfTheWeek;
-  bool checksumPassed;
-};
 /// @brief Initializes the MSFReceiver class which can be used to read time from
-/// MSF radio signal.
+/// MSF radio signal, or from DCF77, WWVB and JJY with their PROTOCOL.
 /// @tparam SAMPLE_RATE_MS  The sample rate in milliseconds at which the
 /// MSFReceiver will read the input pin to detect the presence or absence of the
 /// carrier signal while looking for the minute marker.
-template <int SAMPLE_RATE_MS>
+/// @tparam PROTOCOL Time signal to decode with its Bit A and Bit B windows,
+/// MSFBitWindows (MSFProtocol) by default, see MSFProtocol.h
+/// @tparam DECIMATION Number of carrier reads integrated into one sample of
+/// the minute marker rolling buffer. With SAMPLE_RATE_MS of 1 and DECIMATION
+/// of 10 the receiver needs the memory and CPU of MSFReceiver<10> but still
+/// finds the minute marker with cca 1ms precision.
+/// @tparam OBSERVER Gets the events of the acquisition (scores, bits,
+/// parity and state changes), see MSFNoObserver
+/// @tparam READER Reads the carrier state, the reader functions given to the
+/// constructor by default or the pin register straight away, see MSFReader.h
+template <int SAMPLE_RATE_MS, class PROTOCOL = MSFBitWindows<>, int DECIMATION = 1,
+          class OBSERVER = MSF_TIME_LIB_OBSERVER, class READER = MSFFunctionReader<>>
 class MSFReceiver {
   using ReaderFunction = bool (*)();
 
  private:
-  // TODO: 1500 ms actually gives us 300ms of unmonitored zone, we can probably
-  // reduce this to 1200ms to fit exactly the carrier and silence windows with
-  // no unmonitored zone. This was just some lazy way to make binary safety, see
-  // docstring in updateRollingBuffer function for more details. Will be
-  // eventually removed to save memory
-  static const int MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS = 1500 / SAMPLE_RATE_MS;
-  static const int MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_BYTES =
-      (MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS + 7) / 8;
-
   // if you look at MSF spec document at:
   // https://www.pvelectronics.co.uk/rftime/msf/MSF_Time_Date_Code.pdf you can
   // see that the minute is clearly identifiable by last 59th second having
   // 700ms of carrier followed by 500ms of silence in 0th second of the next
   // minute. We are going to look for this transition, keep its timestamp and
-  // then wait for the next minute boundary to start reading the bits.
-  static const int MINUTE_MARKER_NUM_SAMPLES_CARRIER = 700 / SAMPLE_RATE_MS;
-  static const int MINUTE_MARKER_NUM_SAMPLES_SILENCE = 500 / SAMPLE_RATE_MS;
+  // then wait for the next minute boundary to start reading the bits. The
+  // other time signals mark their minute in much the same way, PROTOCOL tells
+  // us how, see MSFProtocol.h.
+  static_assert(DECIMATION >= 1 && DECIMATION <= 127, "DECIMATION must be between 1 and 127");
+  static const int MARKER_SAMPLE_RATE_MS = SAMPLE_RATE_MS * DECIMATION;
+  static const int MINUTE_MARKER_NUM_SAMPLES_LEAD =
+      PROTOCOL::MARKER_LEAD_SILENCE_MS / MARKER_SAMPLE_RATE_MS;
+  static const int MINUTE_MARKER_NUM_SAMPLES_CARRIER =
+      PROTOCOL::MARKER_CARRIER_MS / MARKER_SAMPLE_RATE_MS;
+  static const int MINUTE_MARKER_NUM_SAMPLES_SILENCE =
+      PROTOCOL::MARKER_SILENCE_MS / MARKER_SAMPLE_RATE_MS;
+  static const int MINUTE_MARKER_NUM_SAMPLES_TRAIL =
+      PROTOCOL::MARKER_TRAIL_CARRIER_MS / MARKER_SAMPLE_RATE_MS;
   static const int LOOKBACK_TOTAL =
-      MINUTE_MARKER_NUM_SAMPLES_CARRIER + MINUTE_MARKER_NUM_SAMPLES_SILENCE;
+      MINUTE_MARKER_NUM_SAMPLES_LEAD + MINUTE_MARKER_NUM_SAMPLES_CARRIER +
+      MINUTE_MARKER_NUM_SAMPLES_SILENCE + MINUTE_MARKER_NUM_SAMPLES_TRAIL;
+  // the best score is at the end of the marker, this long after the minute
+  // starts with the silence window
+  static const uint32_t MARKER_PEAK_AFTER_MINUTE_US =
+      (PROTOCOL::MARKER_SILENCE_MS + PROTOCOL::MARKER_TRAIL_CARRIER_MS) * 1000UL;
+
+  // the rolling buffer fits exactly the marker windows, the sample falling
+  // off the oldest window is always the one about to be
+  // overwritten by the new sample so we dont need any spare room. Rounding it
+  // up to power of two would make the wrap around a mask, but on
+  // MSFReceiver<1> that is 2048 samples instead of 1200, so we count the wrap
+  // around in the cursors instead, see RollingBufferCursor
+  static const int MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS = LOOKBACK_TOTAL;
+  static const int MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_BYTES =
+      (MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS + 7) / 8;
+  // how long the rolling buffer takes to fill up with samples
+  static const int32_t ROLLING_BUFFER_US = LOOKBACK_TOTAL * MARKER_SAMPLE_RATE_MS * 1000L;
 
   // we need to store 60 boolean bit for A and B msf payloads, but bool datatype
-  // takes a whole byte to save memory on smaller platforms, we can pack 8 bits
-  // into a single uint8_t there is helper function below to read/write
-  // individual bits from these packed arrays NOTE: do not read/write directly
-  // to these arrays, use the helper functions to set/get bits.
-  uint8_t packedABits[8];
-  uint8_t packedBBits[8];
+  // takes a whole byte so to save memory on smaller platforms each of them is
+  // packed into a single 64 bit word, see MSFFrame for how to read/write them
+  MSFFrame frame;
+
+  // on top of the hard bits above we keep how sure we were about each of them,
+  // so consecutive minutes can be combined when the signal is too weak to pass
+  // the checksum in a single minute
+  typename PROTOCOL::SoftFrame softFrame;
+  typename PROTOCOL::SoftAccumulator softAccumulator;
+  using ParityGroups = typename PROTOCOL::ParityGroups;
 
   // same as above, when we are listening for a minute marker we want to
-  // store 1.5 seconds of data representing transition between 59th second and
-  // 0th second of new minute. this is again 1500ms / SAMPLE_RATE_MS boolean
-  // samples, which we pack into uint8_t to save memory. This is a rolling
-  // buffer as we never need to store the entire 60s of data NOTE: do not
-  // read/write directly to this buffer, use the helper functions to set/get
-  // bits and update the rolling buffer score.
+  // store 1.2 seconds of data representing transition between 59th second and
+  // 0th second of new minute. this is 1200ms / (SAMPLE_RATE_MS * DECIMATION)
+  // boolean samples, which we pack into uint8_t to save memory. This is a
+  // rolling buffer as we never need to store the entire 60s of data NOTE: do
+  // not read/write directly to this buffer, use updateRollingBuffer() which
+  // also keeps the rolling buffer score.
   uint8_t buffer[MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_BYTES];
 
-  // State variables for syncing to the minute marker.
-  int rollingBufferHead;
+  /// @brief Position of a single sample in the rolling buffer, kept as a byte
+  /// index and a bit mask so moving to the next sample does not need any
+  /// division or modulo
+  struct RollingBufferCursor : MSFBufferPosition {
+    /// @brief Moves the cursor to given sample
+    void seek(int sample) {
+      this->byteIdx = sample / 8;
+      this->mask = 1 << (sample % 8);
+    }
+
+    /// @brief Moves the cursor to the next sample, going back to the start
+    /// after the last one
+    void advance() {
+      static const int LAST = MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS - 1;
+      if (this->byteIdx == LAST / 8 && this->mask == (1 << (LAST % 8))) {
+        this->byteIdx = 0;
+        this->mask = 1;
+        return;
+      }
+      this->mask <<= 1;
+      if (this->mask == 0) {
+        this->mask = 1;
+        this->byteIdx++;
+      }
+    }
+  };
+
+  // State variables for syncing to the minute marker. The head is where the
+  // new sample goes, which is also the oldest sample about to fall off the
+  // carrier window, the silence edge is the sample about to pass from the
+  // silence window into the carrier window. A marker with silence before the
+  // carrier window or carrier after the silence window has an edge cursor for
+  // each of them too, without them there is just the silence edge and the
+  // other two names point at it.
+  static const uint8_t SILENCE_EDGE = 0;
+  static const uint8_t CARRIER_EDGE = MINUTE_MARKER_NUM_SAMPLES_LEAD > 0 ? 1 : 0;
+  static const uint8_t TRAIL_EDGE = MINUTE_MARKER_NUM_SAMPLES_TRAIL > 0 ? CARRIER_EDGE + 1 : 0;
+  static const uint8_t MARKER_EDGES = (CARRIER_EDGE > TRAIL_EDGE ? CARRIER_EDGE : TRAIL_EDGE) + 1;
+  RollingBufferCursor rollingBufferHead;
+  RollingBufferCursor rollingBufferEdges[MARKER_EDGES];
   int rollingBufferCarrierWindowScore;
   int rollingBufferSilenceWindowScore;
 
-  // reader function provided by the user code to read the current state of the
-  // carrier (true for carrier, false for silence)
-  ReaderFunction carrierStateReader;
-
-  /// @brief Helper function used to write a single bit into a packed uint8_t
-  /// array
-  /// @param array the array to write into
-  /// @param index the index of the bit to write (0-based)
-  /// @param value the boolean value to write
-  void writeBit(uint8_t* array, int index, bool value) {
-    if (value)
-      array[index / 8] |= (1 << (index % 8));
-    else
-      array[index / 8] &= ~(1 << (index % 8));
-  }
-  /// @brief Helper function used to read a single bit from a packed uint8_t
-  /// array
-  /// @param array the array to read from
-  /// @param index the index of the bit to read (0-based)
-  /// @return the boolean value of the bit
-  bool readBit(const uint8_t* array, int index) { return (array[index / 8] >> (index % 8)) & 1; }
+  // with DECIMATION we count how many of the carrier reads of the current
+  // rolling buffer sample were carrier, and keep the count of the previous one
+  // to find where exactly the carrier went off
+  uint8_t decimatedReads;
+  uint8_t decimatedCarrierReads;
+  uint8_t previousDecimatedCarrierReads;
+
+  // with more than one receiver module every read goes to all of them and
+  // their weighted vote is the carrier state, see MSFDiversity. With one it
+  // is empty and on 32 bit platforms sits in the padding after the counts above.
+  MSFDiversity<READER::INPUTS, MINUTE_MARKER_NUM_SAMPLES_LEAD, MINUTE_MARKER_NUM_SAMPLES_CARRIER,
+               MINUTE_MARKER_NUM_SAMPLES_SILENCE, MINUTE_MARKER_NUM_SAMPLES_TRAIL, DECIMATION>
+      diversity;
+
+  // reads the current state of the carrier (true for carrier, false for
+  // silence), through the reader function provided by the user code unless
+  // READER says otherwise
+  READER carrierStateReader;
+
+  // in edge capture mode we dont call carrierStateReader at all, instead the
+  // carrier state at any point in time is reconstructed from the transitions
+  // pushed into this buffer by pin change interrupt
+  MSFEdgeBuffer* edgeSource = nullptr;
+  bool edgeLevel = true;
+  // in block sampling mode the carrier is sampled by hardware into this
+  // buffer and we take the samples of our events from its blocks
+  MSFSampleBuffer* sampleSource = nullptr;
+  uint32_t lastCarrierOffEdge;
+  uint32_t carrierOffEdgeAtMaxScore;
+
+  // interval between two samples of the Bit A and Bit B windows, this gives us
+  // the same cca 2kHz sampling the old blocking loop had with its
+  // delayMicroseconds(500)
+  static const uint32_t ACQUIRE_SAMPLE_INTERVAL_US = 500;
+  // in edge capture mode the exact edge is taken over the counted one only if
+  // they are this close, further apart noise has moved one of them
+  static const int32_t EXACT_EDGE_TOLERANCE_US = 4 * ACQUIRE_SAMPLE_INTERVAL_US;
+
+  // Bit A and Bit B windows within each second, both ends are inclusive. We
+  // only sample inside of these, there is no point reading the carrier outside
+  // of them. Bit B can come before Bit A (JJY) or not at all (DCF77), so we
+  // sample them in the order they come in the second.
+  static const uint32_t BIT_A_WINDOW_START_MS = PROTOCOL::BIT_A_START_MS;
+  static const uint32_t BIT_A_WINDOW_END_MS = PROTOCOL::BIT_A_END_MS;
+  static const uint32_t BIT_B_WINDOW_START_MS = PROTOCOL::BIT_B_START_MS;
+  static const uint32_t BIT_B_WINDOW_END_MS = PROTOCOL::BIT_B_END_MS;
+  static const bool BIT_A_FIRST =
+      !PROTOCOL::HAS_BIT_B || BIT_A_WINDOW_START_MS < BIT_B_WINDOW_START_MS;
+  static const uint32_t FIRST_WINDOW_START_MS =
+      BIT_A_FIRST ? BIT_A_WINDOW_START_MS : BIT_B_WINDOW_START_MS;
+  static const uint32_t FIRST_WINDOW_END_MS =
+      BIT_A_FIRST ? BIT_A_WINDOW_END_MS : BIT_B_WINDOW_END_MS;
+  static const uint32_t SECOND_WINDOW_START_MS =
+      BIT_A_FIRST ? BIT_B_WINDOW_START_MS : BIT_A_WINDOW_START_MS;
+  static const uint32_t SECOND_WINDOW_END_MS =
+      BIT_A_FIRST ? BIT_B_WINDOW_END_MS : BIT_A_WINDOW_END_MS;
+  static const uint32_t LAST_WINDOW_END_MS =
+      PROTOCOL::HAS_BIT_B ? SECOND_WINDOW_END_MS : FIRST_WINDOW_END_MS;
+  // the rolling buffer starts full of carrier, so until it is filled with
+  // real samples the silence of any second scores like the end of a marker
+  // if it can be as long as the marker silence (DCF77, JJY). We ignore those
+  // scores then, no MSF second has the 500ms of silence of its marker.
+  static const bool SYNC_WAITS_FOR_BUFFER = PROTOCOL::MARKER_SILENCE_MS <= LAST_WINDOW_END_MS;
+  // most reads a window can take, which sizes its vote counts. On the
+  // default 31ms windows that is 63 and fits a byte, even with a few modules.
+  static const uint16_t BIT_A_MAX_SAMPLES =
+      ((BIT_A_WINDOW_END_MS - BIT_A_WINDOW_START_MS + 1) * 1000UL /
+           ACQUIRE_SAMPLE_INTERVAL_US +
+       1) *
+      READER::INPUTS;
+  static const uint16_t BIT_B_MAX_SAMPLES =
+      ((BIT_B_WINDOW_END_MS - BIT_B_WINDOW_START_MS + 1) * 1000UL /
+           ACQUIRE_SAMPLE_INTERVAL_US +
+       1) *
+      READER::INPUTS;
+  // parts of the second where we know the state, sampled to learn the bit
+  // threshold, see MSFBitThreshold. Silence comes after the second edge search
+  // and before Bit A, carrier well after Bit B (the 0th second of MSF has
+  // silence there, and its edge search covers the silent part). They only
+  // need to add up over the minute, so we sample them sparsely.
+  static const uint32_t KNOWN_SILENCE_START_MS = PROTOCOL::KNOWN_SILENCE_START_MS;
+  static const uint32_t KNOWN_SILENCE_END_MS = PROTOCOL::KNOWN_SILENCE_END_MS;
+  static const uint32_t KNOWN_CARRIER_START_MS = PROTOCOL::KNOWN_CARRIER_START_MS;
+  static const uint32_t KNOWN_CARRIER_END_MS = PROTOCOL::KNOWN_CARRIER_END_MS;
+  static const uint32_t KNOWN_STATE_SAMPLE_INTERVAL_US = 5000;
+  static const uint32_t SYNC_SCAN_DURATION_US = 65000UL * 1000UL;
+  // we only need bits from the 17th second onwards (seconds before carry
+  // DUT1, which we can do without), so until then we can still join the
+  // minute we are in
+  static const int FIRST_DECODED_SECOND = PROTOCOL::FIRST_DECODED_SECOND;
+
+  // every second starts with the carrier going off (100ms, or 500ms on the
+  // minute marker) after at least 700ms of carrier, we sample this far around
+  // the expected second boundary to find out where that edge really is. The
+  // minute edge is searched in much wider window, as we predict it from the
+  // marker we have seen up to 2 minutes before and cheap resonators can drift
+  // a lot in that time. 900ms of carrier before it (second 59 has both bits 0)
+  // makes this safe, after it we have to stop before the first bit window and
+  // before the silence of the marker ends.
+  static const int32_t SECOND_EDGE_SEARCH_US = 30000;
+  static const int32_t MINUTE_EDGE_SEARCH_BEFORE_US =
+      PROTOCOL::MINUTE_EDGE_SEARCH_BEFORE_MS * 1000L;
+  static const int32_t MINUTE_EDGE_SEARCH_AFTER_US =
+      FIRST_WINDOW_START_MS < PROTOCOL::MARKER_SILENCE_MS
+          ? FIRST_WINDOW_START_MS * 1000L - 5000
+          : PROTOCOL::MARKER_SILENCE_MS * 1000L - 20000;
+  static_assert(KNOWN_SILENCE_END_MS < FIRST_WINDOW_START_MS &&
+                    FIRST_WINDOW_START_MS <= FIRST_WINDOW_END_MS &&
+                    (!PROTOCOL::HAS_BIT_B || (FIRST_WINDOW_END_MS < SECOND_WINDOW_START_MS &&
+                                              SECOND_WINDOW_START_MS <= SECOND_WINDOW_END_MS)) &&
+                    LAST_WINDOW_END_MS < KNOWN_CARRIER_START_MS &&
+                    KNOWN_CARRIER_END_MS * 1000L < 1000000L - SECOND_EDGE_SEARCH_US,
+                "Known silence, Bit A/B windows and known carrier must follow each other");
+  // in tracking mode we dont scan for the minute marker, we only check that it
+  // is where we expect it to be, within this tolerance and with at least this
+  // score
+  static const int32_t TRACKING_TOLERANCE_US = 100000;
+  static const int TRACKING_MIN_SCORE = LOOKBACK_TOTAL * 3 / 4;
+  // the rolling buffer has to be filled before the earliest score we check,
+  // so that is how long before the expected minute start we start sampling
+  static const int32_t VERIFY_LEAD_US =
+      ROLLING_BUFFER_US + TRACKING_TOLERANCE_US -
+      (int32_t)MARKER_PEAK_AFTER_MINUTE_US;
+
+  // the minute check only samples the minute bits and the parity bit covering
+  // them, the hour does not change on its own so the rest is not worth the
+  // time the receiver has to be on
+  static const int FIRST_CHECKED_SECOND = PROTOCOL::FIRST_CHECKED_SECOND;
+  static const int LAST_CHECKED_A_SECOND = PROTOCOL::LAST_CHECKED_A_SECOND;
+  static const int CHECKED_PARITY_SECOND = PROTOCOL::CHECKED_PARITY_SECOND;
+  // a marker with lead silence (WWVB) starts within second 59, which only
+  // carries the marker, so we stop a second early and let the rolling buffer
+  // of tracking mode have it
+  static const int LAST_SECOND = PROTOCOL::MARKER_LEAD_SILENCE_MS > 0 ? 58 : 59;
+
+  // when a parity group fails we flip its least confident bit, but only if it
+  // is the only one in the group we were not sure about (less than cca 80% of
+  // the samples on its side), otherwise we would most likely just make another
+  // error pass the parity
+  static const int8_t MAX_CORRECTED_BIT_CONFIDENCE = 50;
+
+  // we never let the per second correction of our clock go beyond this, if
+  // local clock is this bad something else is wrong
+  static const int32_t MAX_SECOND_PERIOD_CORRECTION_US = SECOND_EDGE_SEARCH_US / 4;
+
+  // State machine variables, everything is timestamped in micros() so the
+  // acquisition windows can be sampled at sub millisecond cadence. All the
+  // comparisons are done on differences so micros() overflow is not a problem.
+  MSFState state = MSFState::IDLE;
+  uint32_t stateStartedAt;
+  uint32_t sleepDuration;
+  uint32_t nextSampleAt;
+
+  // sync phase
+  int maxScoreSeen;
+  uint32_t timeOfMaxScore;
+
+  // every peak of the scan is also checked against the second edges that
+  // follow it, the best one is where we align to and if it turns out to be
+  // wrong we fall back to the next one, see MSFSyncCandidates
+  MSFSyncCandidates<MSF_TIME_LIB_SYNC_CANDIDATES> syncCandidates;
+
+  // early exit from sync, once the best score reaches this and nothing better
+  // shows up for the confirmation time we stop scanning, see
+  // set_sync_early_exit()
+  int syncEarlyExitScore = LOOKBACK_TOTAL * 95 / 100;
+  uint32_t syncConfirmationTime = 1000000UL;
+  static const int8_t SYNC_EARLY_EXIT_MIN_EDGE_AGREEMENT = 60;
+
+  // align and acquire phases
+  uint32_t minuteStart;
+  uint32_t secondStart;
+  int currentSecond;
+  // seconds before this one were gone when we joined the minute
+  int firstAcquiredSecond;
+
+  // second edge tracking, we count how many samples around the expected
+  // second boundary were carrier, which tells us where the carrier went off.
+  // secondPeriodCorrection is how much longer (or shorter) a second is on our
+  // local clock, it is learned as we go and kept between acquisitions as it is
+  // mostly given by resonator tolerance
+  uint16_t secondEdgeCarrierSamples, secondEdgeTotalSamples;
+  bool secondEdgeLocked;
+  int32_t lastSecondEdgeError;
+  int32_t secondPeriodCorrection = 0;
+  // every second edge we measured in the minute, the line through them gives
+  // us the minute edge of the result
+  MSFEdgeFit edgeFit;
+
+  // tracking mode, once we decode a minute we carry on with the next one
+  // using the predicted minute marker position instead of syncing again
+  bool tracking = false;
+  bool newResult = false;
+
+  // we only know where the minute is once a minute passed the checksum, and
+  // after restore_lock_state() the next start() goes straight to checking
+  // the marker where the restored state says it is. The reference is the
+  // time of the minute that started at referenceMinuteStart, which is what
+  // we count from to predict the following minutes.
+  bool locked = false;
+  bool restoredLock = false;
+  MSFData referenceTime;
+  uint32_t referenceMinuteStart = 0;
+
+  // minute check, see start_minute_check()
+  bool checking = false;
+  MSFData checkTime;
+  MSFCheckResult checkResult = MSFCheckResult::NONE;
+  MSFBitVote<BIT_A_MAX_SAMPLES> bitAVote;
+  MSFBitVote<BIT_B_MAX_SAMPLES> bitBVote;
+  // the vote in the window is decided, the rest of it is not sampled
+  bool bitADecided, bitBDecided;
+  MSFBitThreshold bitThreshold;
+
+  // signal quality of the result in progress, see MSFSignalQuality. The bit
+  // margins are summed up and averaged once the minute is done.
+  MSFSignalQuality quality;
+  uint32_t phaseStartedAt = 0;
+  uint16_t bitMarginSum;
+  uint8_t bitMarginCount;
+
+  MSFData result;
+
   /// @brief Helper function used to update our rolling buffer which pushes a
   /// new sample in and returns the confidence score of us being currently at
   /// the minute marker transition based on how many samples in the carrier and
@@ -109,34 +384,33 @@ class MSFReceiver {
   int updateRollingBuffer(bool carrierValue) {
     // this is how the perfect minute marker looks like
     // |<- 700ms carrier      ->|<- 500ms silence ->|
-    // our rolling data structure is 1500ms long and we are pushing in the data
+    // our rolling data structure is 1200ms long and we are pushing in the data
     // from the left to right
-    // |<- our carrier region ->|<- our silence region ->|<- unmonitored zone
-    // ->| we track how many samples in our carrier region are actually carrier
+    // |<- our carrier region ->|<- our silence region ->|
+    // we track how many samples in our carrier region are actually carrier
     // and how many samples in our silence region are actually silence and we
     // report that score on the return, where higher score means more confidence
     // that we are currently looking at the minute marker transition right now.
-    // NOTE: unmonitored zone is just for binary safety, will be removed later
-
-    // identify the two samples that are about to leave their windows (silence,
-    // carrier)
-
-    // find the index of the sample thats about to go from silence window to
-    // carrier window
-    int indexAtSilenceEdge = this->rollingBufferHead - MINUTE_MARKER_NUM_SAMPLES_SILENCE;
-    if (indexAtSilenceEdge < 0)
-      indexAtSilenceEdge += MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS;
-
-    // find the index of the sample thats about to fall off the carrier window
-    // into our unmonitored zone
-    int indexAtCarrierEdge = this->rollingBufferHead - LOOKBACK_TOTAL;
-    if (indexAtCarrierEdge < 0)
-      indexAtCarrierEdge += MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS;
-
-    // read the samples at these two edges before we overwrite the
-    // rollingBufferHead with the new sample
-    bool sampleLeavingSilence = this->readBit(this->buffer, indexAtSilenceEdge);
-    bool sampleLeavingCarrier = this->readBit(this->buffer, indexAtCarrierEdge);
+    // Other time signals can have a lead silence window before the carrier
+    // window and a trailing carrier window after the silence one, see
+    // MSFProtocol.h, which count towards the silence and carrier scores.
+
+    // read the samples that are about to leave their windows (silence,
+    // carrier) before we overwrite the oldest one at the head with the new
+    // sample. Without the lead silence the oldest one is the one leaving the
+    // carrier window, without the trailing carrier the new one is the one
+    // entering the silence window.
+    RollingBufferCursor& head = this->rollingBufferHead;
+    RollingBufferCursor& silenceEdge = this->rollingBufferEdges[SILENCE_EDGE];
+    RollingBufferCursor& carrierEdge = this->rollingBufferEdges[CARRIER_EDGE];
+    RollingBufferCursor& trailEdge = this->rollingBufferEdges[TRAIL_EDGE];
+    const bool hasLead = MINUTE_MARKER_NUM_SAMPLES_LEAD > 0;
+    const bool hasTrail = MINUTE_MARKER_NUM_SAMPLES_TRAIL > 0;
+    RollingBufferCursor& carrierEnd = hasLead ? carrierEdge : head;
+    bool sampleLeavingSilence = this->buffer[silenceEdge.byteIdx] & silenceEdge.mask;
+    bool sampleLeavingCarrier = this->buffer[carrierEnd.byteIdx] & carrierEnd.mask;
+    bool sampleEnteringSilence =
+        hasTrail ? (bool)(this->buffer[trailEdge.byteIdx] & trailEdge.mask) : carrierValue;
 
     // --- CARRIER REGION UPDATES ---
 
@@ -152,21 +426,44 @@ class MSFReceiver {
 
     // the new sample that is entering the silence window, if its is silence (0)
     // it is good for our minute marker, so we increase the score
-    if (carrierValue == 0) this->rollingBufferSilenceWindowScore++;
+    if (sampleEnteringSilence == 0) this->rollingBufferSilenceWindowScore++;
 
     // if sample that is leaving silence is silence (0) we are losing a good
     // sample for our minute marker, so we decrease the score
     if (sampleLeavingSilence == 0) this->rollingBufferSilenceWindowScore--;
 
+    // --- LEAD AND TRAIL REGION UPDATES ---
+
+    // the same again for the sample leaving the carrier window into the lead
+    // silence window and the oldest one leaving the lead silence
+    if (hasLead) {
+      if (sampleLeavingCarrier == 0) this->rollingBufferSilenceWindowScore++;
+      bool sampleLeavingLead = this->buffer[head.byteIdx] & head.mask;
+      if (sampleLeavingLead == 0) this->rollingBufferSilenceWindowScore--;
+    }
+
+    // and for the new sample entering the trailing carrier window and the one
+    // leaving it into the silence window
+    if (hasTrail) {
+      if (carrierValue == 1) this->rollingBufferCarrierWindowScore++;
+      if (sampleEnteringSilence == 1) this->rollingBufferCarrierWindowScore--;
+    }
+
     // push the new sample into the buffer, this will overwrite the sample at
     // rollingBufferHead, but we have already accounted for that sample leaving
     // the windows and updated our scores accordingly
-    this->writeBit(this->buffer, this->rollingBufferHead, carrierValue);
+    if (carrierValue)
+      this->buffer[head.byteIdx] |= head.mask;
+    else
+      this->buffer[head.byteIdx] &= ~head.mask;
+
+    // every input of the diversity receiver has a buffer of its own at the
+    // same positions, they learn how much we trust each input while scanning
+    this->diversity.push(head, carrierEdge, silenceEdge, trailEdge, this->state == MSFState::SYNC);
 
-    // if we reached the end of our buffer go back in circle
-    this->rollingBufferHead++;
-    if (this->rollingBufferHead >= MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_NUM_ELEMENTS)
-      this->rollingBufferHead = 0;
+    // all cursors go back in circle once they reach the end of our buffer
+    head.advance();
+    for (uint8_t i = 0; i < MARKER_EDGES; i++) this->rollingBufferEdges[i].advance();
 
     // return both scores togather, where a top score is good carrier window and
     // good silence window
@@ -176,324 +473,1354 @@ class MSFReceiver {
   /// @brief Helper function that cleans up our rolling buffer global variables
   /// and initializes them to be ready for next syn attempt
   void rollingBufferSetupAndCleanup() {
-    this->rollingBufferHead = 0;
+    // buffer starts full of carrier, so the silence edge is right after the
+    // carrier window. The edges we dont have point at the silence edge, so it
+    // goes last.
+    this->rollingBufferHead.seek(0);
+    this->rollingBufferEdges[CARRIER_EDGE].seek(MINUTE_MARKER_NUM_SAMPLES_LEAD);
+    this->rollingBufferEdges[TRAIL_EDGE].seek(MINUTE_MARKER_NUM_SAMPLES_LEAD +
+                                              MINUTE_MARKER_NUM_SAMPLES_CARRIER +
+                                              MINUTE_MARKER_NUM_SAMPLES_SILENCE);
+    this->rollingBufferEdges[SILENCE_EDGE].seek(MINUTE_MARKER_NUM_SAMPLES_LEAD +
+                                                MINUTE_MARKER_NUM_SAMPLES_CARRIER);
     memset(this->buffer, 0xFF, sizeof(this->buffer));
     this->rollingBufferSilenceWindowScore = 0;
-    this->rollingBufferCarrierWindowScore = MINUTE_MARKER_NUM_SAMPLES_CARRIER;
+    this->rollingBufferCarrierWindowScore =
+        MINUTE_MARKER_NUM_SAMPLES_CARRIER + MINUTE_MARKER_NUM_SAMPLES_TRAIL;
+    this->diversity.reset();
+    this->decimatedReads = 0;
+    this->decimatedCarrierReads = 0;
+    this->previousDecimatedCarrierReads = DECIMATION;
   }
 
-  /// @brief Helper function that decodes a BCD value with given weights
-  /// @param startIdx Start index of packed array to read bits from
-  /// @param count  Number of bits to read
-  /// @param weights Array of weights where each idx corresponds to value that
-  /// bit contributes
-  /// @return Decoded integer value
-  int decodeBCD(int startIdx, int count, const int* weights) {
-    int val = 0;
-    for (int i = 0; i < count; i++) {
-      if (startIdx + i >= 60) break;
-      if (this->readBit(this->packedABits, startIdx + i)) val += weights[i];
+  /// @brief Integrates one carrier read into the current rolling buffer
+  /// sample, once we have DECIMATION of them the sample goes into the rolling
+  /// buffer as carrier if most of the reads were carrier. Without decimation
+  /// every read goes straight into the rolling buffer.
+  ///
+  /// When the carrier goes off the counts of the last two samples tell us
+  /// where exactly it happened, for a clean step from carrier to silence the
+  /// number of carrier reads in them is the distance of the edge from the
+  /// start of the older one. That is what lets us find the minute marker with
+  /// the precision of the carrier reads and not of the rolling buffer.
+  /// @param now Timestamp of the read in microseconds
+  /// @param carrier Carrier state at the time of the read
+  /// @param score Output, rolling buffer score if a sample was pushed
+  /// @return True if a sample was pushed into the rolling buffer
+  bool decimateSample(uint32_t now, bool carrier, int& score) {
+    this->diversity.add_read();
+    if (DECIMATION == 1) {
+      score = this->updateRollingBuffer(carrier);
+      return true;
     }
-    return val;
+
+    this->decimatedCarrierReads += carrier;
+    if (++this->decimatedReads < DECIMATION) return false;
+
+    bool decimatedCarrier = this->decimatedCarrierReads * 2 > DECIMATION;
+    bool previousDecimatedCarrier = this->previousDecimatedCarrierReads * 2 > DECIMATION;
+    // in edge capture mode we already know exactly when the carrier went off
+    if (!this->edgeSource && previousDecimatedCarrier && !decimatedCarrier) {
+      uint32_t previousSampleStart = now - (2 * DECIMATION - 1) * SAMPLE_RATE_MS * 1000UL;
+      this->lastCarrierOffEdge =
+          previousSampleStart +
+          (this->previousDecimatedCarrierReads + this->decimatedCarrierReads) * SAMPLE_RATE_MS *
+              1000UL;
+    }
+
+    score = this->updateRollingBuffer(decimatedCarrier);
+    this->previousDecimatedCarrierReads = this->decimatedCarrierReads;
+    this->decimatedReads = 0;
+    this->decimatedCarrierReads = 0;
+    return true;
   }
 
-  /// @brief Helper function that checks parity against MSF spec
-  /// @param startIdx Start index of packed array to read bits from
-  /// @param count Number of bits to read
-  /// @param parityBitIdx Index of parity bit in checksum array
-  /// @return True if parity is correct, false otherwise
-  bool checkParity(int startIdx, int count, int parityBitIdx) {
-    int ones = 0;
-    for (int i = 0; i < count; i++) {
-      if (this->readBit(this->packedABits, startIdx + i)) ones++;
+  /// @brief Moves the state machine to another state and tells the observer
+  /// @param next State to enter
+  /// @param now Current timestamp in microseconds
+  void enterState(MSFState next, uint32_t now) {
+    uint32_t elapsedMs = (now - this->phaseStartedAt) / 1000UL;
+    switch (this->state) {
+      case MSFState::SLEEP:
+        this->quality.sleepMs += elapsedMs;
+        break;
+      case MSFState::SYNC:
+        this->quality.syncMs += elapsedMs;
+        break;
+      case MSFState::ALIGN:
+        this->quality.alignMs += elapsedMs;
+        break;
+      case MSFState::VERIFY:
+        this->quality.verifyMs += elapsedMs;
+        break;
+      case MSFState::ACQUIRE:
+        this->quality.acquireMs += elapsedMs;
+        break;
+      default:
+        break;
     }
-    if (this->readBit(this->packedBBits, parityBitIdx)) ones++;
-    return (ones % 2 != 0);
+    this->phaseStartedAt = now;
+    this->state = next;
+    OBSERVER::on_state(next, now);
+  }
+
+  /// @brief Starts collecting the signal quality of the next result
+  void resetQuality() {
+    this->quality = MSFSignalQuality();
+    this->bitMarginSum = 0;
+    this->bitMarginCount = 0;
+  }
+
+  /// @brief Returns the signal quality collected since the last result
+  MSFSignalQuality finishedQuality() const {
+    MSFSignalQuality finished = this->quality;
+    if (this->bitMarginCount > 0)
+      finished.meanBitMargin = this->bitMarginSum / this->bitMarginCount;
+    return finished;
   }
 
-  /// @brief Helper function that sleeps for a random time between 1 and 5
-  /// seconds.
-  // TODO: Add yield() if espressif platform
-  void sleepForRandomTime() {
-    uint32_t sleepTime = random(1000, 5000);
+  /// @brief Converts a rolling buffer score to percent of a perfect one
+  static uint8_t markerConfidence(int score) { return (int32_t)score * 100 / LOOKBACK_TOTAL; }
+
+  /// @brief Enters the SLEEP state for a random time between 1 and 5 seconds,
+  /// to avoid always syncing on the same spot if we are very close to the
+  /// minute marker, in case we miss it first time we dont want to keep missing
+  /// it
+  void enterSleep(uint32_t now) {
+    this->sleepDuration = random(1000, 5000);
 
     MSF_TIME_LIB_LOG(F("[MSF] Sleeping for "));
-    MSF_TIME_LIB_LOG(sleepTime);
+    MSF_TIME_LIB_LOG(this->sleepDuration);
     MSF_TIME_LIB_LOGLN(F("ms to avoid always syncing at the same time..."));
 
-    uint32_t currentMillis = millis();
-    while (millis() - currentMillis < sleepTime) {
-      delay(1);
-    }
+    this->sleepDuration *= 1000UL;
+    this->stateStartedAt = now;
+    this->enterState(MSFState::SLEEP, now);
   }
 
-  /// @brief Function that searches for minute marker transition and returns the
-  /// timestamp of when we think the minute marker transition happens.
-  /// @return Timestamp in milliseconds of the detected minute marker transition
-  uint32_t syncToMinuteMarker() {
-    // This function continuously reads the input via carrierStateReader
-    // function, passes the output to the updateRollingBuffer function, gets the
-    // score from its output and keeps timestamp of when we see the best score.
-    // After this function we can setup our listening windows for reading A and
-    // B bits of MFS signal.
-
-    // to avoid always syncing on the same spot if we are very close to the
-    // minute marker, in case we miss it first time we ∏dont want to keep
-    // missing it
-    this->sleepForRandomTime();
-
+  /// @brief Enters the SYNC state, initializing the rolling buffer and the
+  /// variables used to track the best minute marker score
+  void enterSync(uint32_t now) {
     MSF_TIME_LIB_LOGLN(F("[MSF] Syncing... (Scanning 65s for Minute Marker)"));
 
     // initialize the private variables used for tracking our rolling buffer and
     // its score
     this->rollingBufferSetupAndCleanup();
+    // whatever minute we find next does not follow the ones we kept
+    this->softAccumulator.reset();
+    this->syncCandidates.reset(LOOKBACK_TOTAL);
+    this->locked = false;
+
+    this->stateStartedAt = now;
+    this->nextSampleAt = now;
+    this->maxScoreSeen = 0;
+    this->timeOfMaxScore = now;
+    this->lastCarrierOffEdge = now;
+    this->carrierOffEdgeAtMaxScore = now;
+    this->enterState(MSFState::SYNC, now);
+  }
 
-    uint32_t startScan = millis();
-    uint32_t lastSample = 0;
-    uint32_t lastPrint = 0;
-    int maxScoreSeen = 0;
-    int lastCalculatedScore = 0;
-    uint32_t timeOfMaxScore = 0;
-
-    while (millis() - startScan < 65000) {
-      uint32_t now = millis();
-      if (now - lastSample >= SAMPLE_RATE_MS) {
-        lastSample = now;
-        // MSF spec defines presence of carrier as binary 0 and absence of
-        // carrier (silence) as binary 1 but we dont invert here because we are
-        // only interested in carrier presence or absence
-        int currentScore = this->updateRollingBuffer(this->carrierStateReader());
-        lastCalculatedScore = currentScore;
-
-        if (currentScore > maxScoreSeen) {
-          maxScoreSeen = currentScore;
-          timeOfMaxScore = now;
-        }
-      }
-
-      if (now - lastPrint >= 100) {
-        lastPrint = now;
-        MSF_TIME_LIB_LOG(F("\r[MSF] T+"));
-        MSF_TIME_LIB_LOG((now - startScan) / 1000);
-        MSF_TIME_LIB_LOG(F("."));
-        MSF_TIME_LIB_LOG(((now - startScan) % 1000) / 100);
-        MSF_TIME_LIB_LOG(F("s | Curr: "));
-        MSF_TIME_LIB_LOG(lastCalculatedScore);
-        MSF_TIME_LIB_LOG(F(" | Best: "));
-        MSF_TIME_LIB_LOG(maxScoreSeen);
-        MSF_TIME_LIB_LOG(F("         "));
+  /// @brief Processes one sample of the minute marker scan. This passes the
+  /// carrier state to the updateRollingBuffer function, gets the score from its
+  /// output and keeps timestamp of when we see the best score. After 65s of
+  /// scanning we move to ALIGN state.
+  /// @param now Timestamp of the sample in microseconds
+  /// @param carrier Carrier state at the time of the sample
+  void syncSample(uint32_t now, bool carrier) {
+    this->nextSampleAt = now + SAMPLE_RATE_MS * 1000UL;
+    // MSF spec defines presence of carrier as binary 0 and absence of
+    // carrier (silence) as binary 1 but we dont invert here because we are
+    // only interested in carrier presence or absence
+    int currentScore;
+    if (this->decimateSample(now, carrier, currentScore) &&
+        (!SYNC_WAITS_FOR_BUFFER || now - this->stateStartedAt >= (uint32_t)ROLLING_BUFFER_US)) {
+      if (currentScore > this->maxScoreSeen) {
+        this->maxScoreSeen = currentScore;
+        this->timeOfMaxScore = now;
+        this->carrierOffEdgeAtMaxScore = this->lastCarrierOffEdge;
       }
+      this->syncCandidates.offer(this->minuteStartFromPeak(now, this->lastCarrierOffEdge),
+                                 currentScore);
+      OBSERVER::on_sync_score(now, currentScore, this->maxScoreSeen);
+    }
+    this->syncCandidates.sample(now, carrier, 1000000L + this->secondPeriodCorrection,
+                               MARKER_PEAK_AFTER_MINUTE_US);
+
+    // on clean signal we can be sure very quickly we found the minute marker,
+    // normal seconds can hardly get over 80% of the score, so once we see a
+    // peak over the threshold and it is not beaten for a while we are done.
+    // A noise spike can get over the threshold as well, but the second edges
+    // after it are not where it says they should be
+    if (this->syncEarlyExitScore > 0 && this->maxScoreSeen >= this->syncEarlyExitScore &&
+        now - this->timeOfMaxScore >= this->syncConfirmationTime &&
+        this->syncCandidates.edge_agreement_at(this->minuteStartFromMaxScore()) >=
+            SYNC_EARLY_EXIT_MIN_EDGE_AGREEMENT) {
+      MSF_TIME_LIB_LOGLN();
+      MSF_TIME_LIB_LOG(F("[MSF] Confident peak found after "));
+      MSF_TIME_LIB_LOG((now - this->stateStartedAt) / 1000UL);
+      MSF_TIME_LIB_LOG(F("ms, stopping scan early"));
+      this->enterAlign(now);
+      return;
     }
 
-    MSF_TIME_LIB_LOGLN();
-    MSF_TIME_LIB_LOG(F("[MSF] Final Peak Score: "));
-    MSF_TIME_LIB_LOG(maxScoreSeen);
-    MSF_TIME_LIB_LOGLN();
+    if (now - this->stateStartedAt >= SYNC_SCAN_DURATION_US) this->enterAlign(now);
+  }
+
+  /// @brief Calculates the start of the minute from the timestamp of the best
+  /// minute marker score
+  /// @return Timestamp of the minute start in microseconds
+  uint32_t minuteStartFromMaxScore() const {
+    return this->minuteStartFromPeak(this->timeOfMaxScore, this->carrierOffEdgeAtMaxScore);
+  }
+
+  /// @brief Calculates the start of the minute from the timestamp of a minute
+  /// marker score
+  /// @param timeOfPeak Timestamp of the score in microseconds
+  /// @param carrierOffEdge Timestamp of the last carrier going off before it
+  /// @return Timestamp of the minute start in microseconds
+  uint32_t minuteStartFromPeak(uint32_t timeOfPeak, uint32_t carrierOffEdge) const {
     // we subtract 500ms because the silence window on minute marker ends 500ms
     // after transition between carrier and silence, but that transition
-    // actually marks the start of the minute
-    return timeOfMaxScore - 500;
+    // actually marks the start of the minute (other signals have their own
+    // silence and trailing carrier, see MSFProtocol.h)
+    uint32_t minuteStartEstimate = timeOfPeak - MARKER_PEAK_AFTER_MINUTE_US;
+
+    // in edge capture mode we know exactly when the carrier went off, so if
+    // there is an edge within couple of samples of our estimate that is the
+    // real start of the minute with microsecond precision, with decimation
+    // we know it with the precision of the carrier reads, see decimateSample()
+    if (this->edgeSource || DECIMATION > 1) {
+      int32_t edgeError = (int32_t)(carrierOffEdge - minuteStartEstimate);
+      if (edgeError < 0) edgeError = -edgeError;
+      if ((uint32_t)edgeError <= 2 * MARKER_SAMPLE_RATE_MS * 1000UL) return carrierOffEdge;
+    }
+    return minuteStartEstimate;
+  }
+
+  /// @brief Enters the ALIGN state at the end of the scan, based on the best
+  /// ranked minute marker candidate
+  void enterAlign(uint32_t now) {
+    MSFSyncPeakEvent peak;
+    peak.bestScore = this->maxScoreSeen;
+    peak.perfectScore = LOOKBACK_TOTAL;
+
+    // the best candidate is normally the best peak as well, but a noise spike
+    // with second edges at wrong places loses to the real marker here
+    MSFSyncCandidate best;
+    if (this->syncCandidates.pop_best(best)) {
+      peak.minuteStart = best.minuteStart;
+      peak.markerScore = best.markerScore;
+      peak.rank = this->syncCandidates.rank(best);
+    } else {
+      peak.minuteStart = this->minuteStartFromMaxScore();
+      peak.markerScore = this->maxScoreSeen;
+      peak.rank = 0;
+    }
+    OBSERVER::on_sync_peak(peak);
+    this->quality.markerConfidence = markerConfidence(peak.markerScore);
+    this->alignToMarker(now, peak.minuteStart);
   }
-  /// @brief Helper function that waits until the next minute boundary after
-  /// syncing to the minute marker transition
-  /// @return Timestamp in milliseconds of when we think the next minute starts,
-  /// which is when we should start reading the bits of MSF signal
-  uint32_t get_next_bit_retrieval_timestamp() {
-    uint32_t prevMinuteMillis = this->syncToMinuteMarker();
 
-    // calculate how long we need to wait
-    uint32_t elapsedSinceMarker = millis() - prevMinuteMillis;
+  /// @brief Enters the ALIGN state, calculating when the next minute starts
+  /// based on the start of a minute we have seen, or joins the minute straight
+  /// away if it just started
+  /// @param now Current timestamp in microseconds
+  /// @param prevMinute Timestamp of a minute start in microseconds
+  void alignToMarker(uint32_t now, uint32_t prevMinute) {
+    // if the marker we found is not long gone (early exit from the scan, or it
+    // just happened to be at the end of it) we can still catch all the seconds
+    // we decode from the current minute, no need to wait for the next one
+    uint32_t elapsedSinceMarker = now - prevMinute;
+    int joinSecond = (elapsedSinceMarker + SECOND_EDGE_SEARCH_US) / 1000000UL + 1;
+    if (joinSecond <= FIRST_DECODED_SECOND) {
+      MSF_TIME_LIB_LOG(F("[MSF] Sync Complete. Joining current minute at second "));
+      MSF_TIME_LIB_LOG(joinSecond);
+      MSF_TIME_LIB_LOGLN();
+      this->minuteStart = prevMinute;
+      this->joinMinute(now, joinSecond);
+      return;
+    }
 
     // The remainder tells us how far we are into the CURRENT 60s cycle.
     // Subtracting that from 60000 gives us the exact time remaining until the
     // NEXT cycle. this is needed as we are listening for more than 60s in
-    // syncToMinuteMarker function so if we get result very early we cant just
-    // wait for hardcoded 60s, we might need more
-    uint32_t waitInMiliseconds = 60000 - (elapsedSinceMarker % 60000);
+    // sync state so if we get result very early we cant just wait for
+    // hardcoded 60s, we might need more
+    uint32_t waitInMicroseconds = 60000000UL - (elapsedSinceMarker % 60000000UL);
+    // if we already know how fast our clock runs from previous acquisitions
+    // take it into account, a second on our clock is not exactly 1000000us
+    int32_t secondsSinceMarker = (elapsedSinceMarker + waitInMicroseconds) / 1000000UL;
+    waitInMicroseconds += this->secondPeriodCorrection * secondsSinceMarker;
+    this->minuteStart = now + waitInMicroseconds;
+
+    MSF_TIME_LIB_LOG(F("[MSF] Sync Complete. Aligning to next minute (Will wait for: "));
+    MSF_TIME_LIB_LOG(waitInMicroseconds / 1000UL);
+    MSF_TIME_LIB_LOGLN(F("ms)..."));
+
+    this->enterState(MSFState::ALIGN, now);
+  }
+
+  /// @brief Enters the ACQUIRE state, resetting the captured frame and the
+  /// per second accumulators. We enter this state MINUTE_EDGE_SEARCH_BEFORE_US
+  /// before the minute starts so we can catch the carrier going off at the
+  /// start of the 0th second.
+  void enterAcquire(uint32_t now) {
+    this->secondStart = this->minuteStart;
+    this->currentSecond = 0;
+    this->firstAcquiredSecond = 0;
+    this->nextSampleAt = now;
+    this->edgeFit.reset();
+
+    // Reset Member Variables
+    this->frame.clear();
+    this->softFrame.clear();
+    this->resetBitAccumulators();
+
+    this->logAcquireHeader();
+    this->enterState(MSFState::ACQUIRE, now);
+  }
+
+  /// @brief Prints the header of the per second debug table
+  void logAcquireHeader() {
+    MSF_TIME_LIB_LOGLN(F("[MSF] Starting decode NOW."));
+    MSF_TIME_LIB_LOG(F("[MSF] Bit threshold: "));
+    MSF_TIME_LIB_LOG((int)this->bitThreshold.get_percent());
+    MSF_TIME_LIB_LOGLN(F("%"));
+
+    MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
+    MSF_TIME_LIB_LOG(F("[MSF] SEC |   BIT A ("));
+    MSF_TIME_LIB_LOG(BIT_A_WINDOW_START_MS);
+    MSF_TIME_LIB_LOG(F("-"));
+    MSF_TIME_LIB_LOG(BIT_A_WINDOW_END_MS);
+    MSF_TIME_LIB_LOG(F("ms)   |   BIT B ("));
+    MSF_TIME_LIB_LOG(BIT_B_WINDOW_START_MS);
+    MSF_TIME_LIB_LOG(F("-"));
+    MSF_TIME_LIB_LOG(BIT_B_WINDOW_END_MS);
+    MSF_TIME_LIB_LOGLN(F("ms)"));
+    MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
+  }
+
+  /// @brief Enters the VERIFY state, used in tracking mode after the last
+  /// second of the minute is captured. Instead of scanning 65s for the minute
+  /// marker we run the rolling buffer just over the next minute marker and
+  /// check it has the score we expect.
+  void enterVerify(uint32_t now) {
+    // the last second is finished, so the next minute starts this many
+    // seconds after it
+    uint32_t secondPeriod = 1000000L + this->secondPeriodCorrection;
+    this->verifyMinuteAt(now, this->nextSecondStart() + (59 - LAST_SECOND) * secondPeriod);
+  }
+
+  /// @brief Enters the VERIFY state for the minute marker at given minute
+  /// start. We only start sampling when the rolling buffer needs to be filled
+  /// for the earliest score we check.
+  /// @param now Current timestamp in microseconds
+  /// @param expectedMinuteStart Where we expect the minute to start
+  void verifyMinuteAt(uint32_t now, uint32_t expectedMinuteStart) {
+    this->rollingBufferSetupAndCleanup();
+    this->minuteStart = expectedMinuteStart;
+    uint32_t verifyFrom = expectedMinuteStart - VERIFY_LEAD_US;
+    this->nextSampleAt = (int32_t)(verifyFrom - now) > 0 ? verifyFrom : now;
+    this->maxScoreSeen = 0;
+    this->timeOfMaxScore = this->minuteStart + MARKER_PEAK_AFTER_MINUTE_US;
+    this->carrierOffEdgeAtMaxScore = this->minuteStart;
+    this->enterState(MSFState::VERIFY, now);
+  }
+
+  /// @brief Processes one sample of the minute marker check in tracking mode.
+  /// If the marker is where we expected it we carry on acquiring the new minute
+  /// from its 1st second, otherwise we lost the signal and need to sync again.
+  /// @param now Timestamp of the sample in microseconds
+  /// @param carrier Carrier state at the time of the sample
+  void verifySample(uint32_t now, bool carrier) {
+    this->nextSampleAt = now + SAMPLE_RATE_MS * 1000UL;
+    int currentScore;
+    bool scored = this->decimateSample(now, carrier, currentScore);
+
+    int32_t fromExpectedPeak = (int32_t)(now - (this->minuteStart + MARKER_PEAK_AFTER_MINUTE_US));
+    if (fromExpectedPeak < -TRACKING_TOLERANCE_US) return;
+    if (fromExpectedPeak <= TRACKING_TOLERANCE_US) {
+      if (scored && currentScore > this->maxScoreSeen) {
+        this->maxScoreSeen = currentScore;
+        this->timeOfMaxScore = now;
+        this->carrierOffEdgeAtMaxScore = this->lastCarrierOffEdge;
+      }
+      return;
+    }
+
+    MSF_TIME_LIB_LOG(F("[MSF] Tracking, minute marker score: "));
+    MSF_TIME_LIB_LOG(this->maxScoreSeen);
+    MSF_TIME_LIB_LOGLN();
+
+    if (this->maxScoreSeen < TRACKING_MIN_SCORE && this->checking) {
+      MSF_TIME_LIB_LOGLN(F("[MSF] Minute marker not where expected, check failed"));
+      this->finishCheck(now, MSFCheckResult::NO_MARKER);
+      return;
+    }
+    if (this->maxScoreSeen < TRACKING_MIN_SCORE) {
+      // the marker we aligned to was wrong, or we lost it. Either way the
+      // other candidates from the last scan are still worth a try before we
+      // spend over a minute scanning again
+      // candidates that would not pass this check either are not worth the
+      // minute it takes to find out
+      MSFSyncCandidate next;
+      bool found = false;
+      while (!found && this->syncCandidates.pop_best(next))
+        found = next.markerScore >= TRACKING_MIN_SCORE;
+      if (found) {
+        MSF_TIME_LIB_LOGLN(F("[MSF] Minute marker not where expected, trying next candidate..."));
+        this->softAccumulator.reset();
+        this->alignToMarker(now, next.minuteStart);
+        return;
+      }
+      MSF_TIME_LIB_LOGLN(F("[MSF] Minute marker not where expected, syncing again..."));
+      this->enterSync(now);
+      return;
+    }
+
+    // marker is there, the 0th second is already gone but we dont need its
+    // bits for decoding anyway. How well each
+    // input scored on it is how much we trust it for the minute.
+    this->diversity.update_weights();
+    this->quality.markerConfidence = markerConfidence(this->maxScoreSeen);
+    this->minuteStart = this->minuteStartFromMaxScore();
+    this->joinMinute(now, this->checking ? FIRST_CHECKED_SECOND : 1);
+  }
+
+  /// @brief Enters the ACQUIRE state in the middle of the minute that started
+  /// at minuteStart, skipping the seconds that are already gone. Skipped bits
+  /// are left as 0, none of them is decoded.
+  /// @param now Current timestamp in microseconds
+  /// @param second First second of the minute to acquire (1-59)
+  void joinMinute(uint32_t now, int second) {
+    this->frame.clear();
+    this->softFrame.clear();
+    this->currentSecond = second;
+    this->firstAcquiredSecond = second;
+    this->edgeFit.reset();
+    this->secondStart =
+        this->minuteStart + (1000000L + this->secondPeriodCorrection) * (int32_t)second;
+    this->resetBitAccumulators();
+    this->nextSampleAt = this->nextAcquireSampleTime(now);
+
+    this->logAcquireHeader();
+    this->enterState(MSFState::ACQUIRE, now);
+  }
+
+  /// @brief Helper function that resets the Bit A and Bit B sample counters
+  /// before the next second
+  void resetBitAccumulators() {
+    this->bitAVote.reset();
+    this->bitBVote.reset();
+    this->bitADecided = false;
+    this->bitBDecided = false;
+    this->secondEdgeCarrierSamples = 0;
+    this->secondEdgeTotalSamples = 0;
+    this->secondEdgeLocked = false;
+    this->lastSecondEdgeError = 0;
+  }
+
+  /// @brief Returns the start of the next second on our local clock, corrected
+  /// by what we learned about its drift from the previous second edges
+  uint32_t nextSecondStart() const {
+    return this->secondStart + 1000000UL + this->secondPeriodCorrection;
+  }
+
+  /// @brief Returns how far before the start of given second we start looking
+  /// for the carrier going off
+  /// @param second Second of the minute (0-59)
+  /// @return Time in microseconds
+  static int32_t secondEdgeSearchBefore(int second) {
+    return second == 0 ? MINUTE_EDGE_SEARCH_BEFORE_US : SECOND_EDGE_SEARCH_US;
+  }
+
+  /// @brief Returns how far after the start of given second we keep looking
+  /// for the carrier going off
+  /// @param second Second of the minute (0-59)
+  /// @return Time in microseconds
+  static int32_t secondEdgeSearchAfter(int second) {
+    return second == 0 ? MINUTE_EDGE_SEARCH_AFTER_US : SECOND_EDGE_SEARCH_US;
+  }
+
+  /// @brief Finds where the carrier went off around the expected start of the
+  /// current second and moves the Bit A and Bit B windows accordingly. The
+  /// carrier is on for at least 700ms before every second boundary and off for
+  /// at least 100ms after it, so the fraction of carrier samples in the search
+  /// window tells us where the edge is. This is the same counting trick as the
+  /// rolling buffer uses and is resilient to the odd noisy sample.
+  void lockSecondEdge() {
+    this->secondEdgeLocked = true;
+
+    // if the whole window is carrier or silence the edge is not in it (or the
+    // signal is gone), better not to touch anything than to follow noise
+    if (this->secondEdgeCarrierSamples == 0 ||
+        this->secondEdgeCarrierSamples == this->secondEdgeTotalSamples)
+      return;
+
+    // we never take more than one sample every ACQUIRE_SAMPLE_INTERVAL_US so
+    // this can not overflow even for the wide minute edge window
+    int32_t searchBefore = secondEdgeSearchBefore(this->currentSecond);
+    int32_t searchSpan = searchBefore + secondEdgeSearchAfter(this->currentSecond);
+    int32_t error =
+        searchSpan * this->secondEdgeCarrierSamples / this->secondEdgeTotalSamples - searchBefore;
+    this->lastSecondEdgeError = error;
+    // the edge is somewhere between the last carrier sample and the first
+    // silence one, counting puts it on the latter so the line gets the middle
+    this->fitSecondEdge(error - searchSpan / (2 * this->secondEdgeTotalSamples));
+
+    // the minute edge is where our alignment wait ended, so whatever error we
+    // see there is just our prediction being off, take it as is
+    if (this->currentSecond == 0) {
+      this->secondStart += error;
+      return;
+    }
+
+    // move the current second halfway to the measured edge, so single noisy
+    // measurement does not throw us off, and slowly learn how long a second is
+    // on our clock so the prediction for the next edge gets better
+    this->secondStart += error / 2;
+    this->secondPeriodCorrection += error / 8;
+    if (this->secondPeriodCorrection > MAX_SECOND_PERIOD_CORRECTION_US)
+      this->secondPeriodCorrection = MAX_SECOND_PERIOD_CORRECTION_US;
+    if (this->secondPeriodCorrection < -MAX_SECOND_PERIOD_CORRECTION_US)
+      this->secondPeriodCorrection = -MAX_SECOND_PERIOD_CORRECTION_US;
+  }
+
+  /// @brief Adds the edge lockSecondEdge() measured to the line we fit
+  /// through the minute. In edge capture mode we know exactly when the carrier
+  /// went off, and take that unless noise moved it away from the counted edge.
+  /// @param error Where the counted edge is from the start of the current
+  /// second in microseconds
+  void fitSecondEdge(int32_t error) {
+    // while the lock is still catching up with the edge it is at the end of
+    // the search window, or past it, and the count only tells us the window
+    // is too early or too late
+    int32_t limit = secondEdgeSearchBefore(this->currentSecond) / 2;
+    if (error > limit || error < -limit) return;
+    if (this->edgeSource) {
+      int32_t exact = (int32_t)(this->lastCarrierOffEdge - this->secondStart);
+      int32_t difference = exact - error;
+      if (difference < 0) difference = -difference;
+      if (difference <= EXACT_EDGE_TOLERANCE_US) error = exact;
+    }
+    int32_t offset = (int32_t)(this->secondStart - this->minuteStart) + error -
+                     1000000L * this->currentSecond;
+    this->edgeFit.add(this->currentSecond, offset);
+  }
+
+  /// @brief Returns the micros() timestamp of the end of the minute we
+  /// acquired, from the line through its second edges if we measured enough
+  /// of them and from the last edge otherwise
+  /// @param errorUs Output, standard error of the timestamp, see
+  /// MSFData::minuteEdgeErrorMicros
+  uint32_t fittedMinuteEdge(uint16_t& errorUs) const {
+    int32_t offset;
+    if (this->edgeFit.estimate(60, offset, errorUs)) return this->minuteStart + 60000000UL + offset;
+    return this->lockedMinuteStart() + this->realToLocalTime(60000000UL);
+  }
+
+  /// @brief Checks the vote of the first bit window of the second is decided
+  bool firstWindowDecided() const { return BIT_A_FIRST ? this->bitADecided : this->bitBDecided; }
+
+  /// @brief Checks the vote of the second bit window of the second is decided
+  bool secondWindowDecided() const { return BIT_A_FIRST ? this->bitBDecided : this->bitADecided; }
+
+  /// @brief Calculates when we need the next sample while acquiring bits. We
+  /// sample every ACQUIRE_SAMPLE_INTERVAL_US around the second boundary and
+  /// inside of Bit A and Bit B windows until their vote is decided, every
+  /// KNOWN_STATE_SAMPLE_INTERVAL_US in the known silence and carrier and skip
+  /// everything in between. The first sample of the next second search window
+  /// is also where we store the bits of finished second.
+  /// @param now Timestamp of the last sample in microseconds
+  /// @return Timestamp of the next sample in microseconds
+  uint32_t nextAcquireSampleTime(uint32_t now) {
+    uint32_t next = now + ACQUIRE_SAMPLE_INTERVAL_US;
+    int32_t inSecond = (int32_t)(next - this->secondStart);
+    if (inSecond < -secondEdgeSearchBefore(this->currentSecond))
+      return this->secondStart - secondEdgeSearchBefore(this->currentSecond);
+    if (inSecond < secondEdgeSearchAfter(this->currentSecond)) return next;
+
+    uint32_t sparse = now + KNOWN_STATE_SAMPLE_INTERVAL_US;
+    int32_t sparseInSecond = (int32_t)(sparse - this->secondStart);
+    if (this->currentSecond != PROTOCOL::NO_KNOWN_SILENCE_SECOND) {
+      if (inSecond < (int32_t)(KNOWN_SILENCE_START_MS * 1000UL))
+        return this->secondStart + KNOWN_SILENCE_START_MS * 1000UL;
+      if (sparseInSecond < (int32_t)((KNOWN_SILENCE_END_MS + 1) * 1000UL)) return sparse;
+    }
 
-    uint32_t nextMinuteMillis = millis() + waitInMiliseconds;
+    if (inSecond < (int32_t)(FIRST_WINDOW_START_MS * 1000UL))
+      return this->secondStart + FIRST_WINDOW_START_MS * 1000UL;
+    if (inSecond < (int32_t)((FIRST_WINDOW_END_MS + 1) * 1000UL) && !this->firstWindowDecided())
+      return next;
+    if (PROTOCOL::HAS_BIT_B) {
+      if (inSecond < (int32_t)(SECOND_WINDOW_START_MS * 1000UL))
+        return this->secondStart + SECOND_WINDOW_START_MS * 1000UL;
+      if (inSecond < (int32_t)((SECOND_WINDOW_END_MS + 1) * 1000UL) &&
+          !this->secondWindowDecided())
+        return next;
+    }
+
+    // the last second is done with its last bit window, there is no carrier
+    // part to sample
+    if (this->currentSecond != PROTOCOL::NO_KNOWN_CARRIER_SECOND &&
+        this->currentSecond != this->lastAcquiredSecond()) {
+      if (inSecond < (int32_t)(KNOWN_CARRIER_START_MS * 1000UL))
+        return this->secondStart + KNOWN_CARRIER_START_MS * 1000UL;
+      if (sparseInSecond < (int32_t)((KNOWN_CARRIER_END_MS + 1) * 1000UL)) return sparse;
+    }
+    return this->currentSecondEnd();
+  }
+
+  /// @brief Returns the timestamp at which we are done with the current
+  /// second and can store its bits. This is where the edge search window of
+  /// the next second starts, apart from the last second of the minute which
+  /// is done as soon as its last bit window is.
+  uint32_t currentSecondEnd() const {
+    if (this->currentSecond == this->lastAcquiredSecond())
+      return this->secondStart + (LAST_WINDOW_END_MS + 1) * 1000UL;
+    return this->nextSecondStart() - SECOND_EDGE_SEARCH_US;
+  }
+
+  /// @brief Processes one sample of the Bit A/B windows, and stores the bits
+  /// of the current second once we cross its boundary. After 60 seconds we
+  /// move to DECODE state.
+  /// @param now Timestamp of the sample in microseconds
+  /// @param carrier Carrier state at the time of the sample
+  void acquireSample(uint32_t now, bool carrier) {
+    // PROCESS & STORE (End of Second)
+    // Check if we are done with the current second. If so, calculate the final
+    // bit for it. If tick() was not called for a while we might have crossed
+    // more than one, those seconds will just have no samples.
+    while ((int32_t)(now - this->currentSecondEnd()) >= 0) {
+      this->storeCurrentSecond();
+
+      if (this->currentSecond == this->lastAcquiredSecond()) {
+        MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
+        if (this->checking)
+          this->finishCheck(now, this->matchesCheckTime() ? MSFCheckResult::CONFIRMED
+                                                          : MSFCheckResult::MISMATCH);
+        else
+          this->finishMinute(now);
+        return;
+      }
+
+      // Prepare for next second, the minute check skips the ones it does not
+      // need
+      int nextSecond = this->currentSecond + 1;
+      if (this->checking && this->currentSecond == LAST_CHECKED_A_SECOND)
+        nextSecond = CHECKED_PARITY_SECOND;
+      while (this->currentSecond < nextSecond) {
+        this->currentSecond++;
+        this->secondStart = this->nextSecondStart();
+      }
+      this->resetBitAccumulators();
+    }
 
-    return nextMinuteMillis;
+    int32_t inSecond = (int32_t)(now - this->secondStart);
+    // too early, this can only happen right after the minute marker check in
+    // tracking mode
+    if (inSecond < -secondEdgeSearchBefore(this->currentSecond)) {
+      this->nextSampleAt = this->nextAcquireSampleTime(now);
+      return;
+    }
+    if (inSecond < secondEdgeSearchAfter(this->currentSecond)) {
+      // still looking for the carrier going off at the start of this second
+      this->secondEdgeTotalSamples++;
+      if (carrier) this->secondEdgeCarrierSamples++;
+      this->nextSampleAt = this->nextAcquireSampleTime(now);
+      return;
+    }
+    if (!this->secondEdgeLocked) {
+      this->lockSecondEdge();
+      inSecond = (int32_t)(now - this->secondStart);
+    }
+
+    // MSF spec defines presence of carrier as binary 0 and absence of
+    // carrier (silence) as binary 1 we invert the carrier state here to
+    // make it more intuitive to work with, where 1 means presence of
+    // carrier and 0 means silence
+    bool binaryState = !carrier;
+
+    // Accumulate data if we are inside the specific windows for Bit A or
+    // Bit B we read multiple time in the window to be more resilient and
+    // later we will take vote based on percentage of samples, but once one
+    // side is far enough ahead the rest of the window would not change it.
+    // With several receiver modules every trusted one gives us a sample.
+    uint8_t samples = 1;
+    uint8_t highSamples = binaryState;
+    if (this->diversity.is_active()) this->diversity.last_samples(samples, highSamples);
+    if (inSecond >= (int32_t)(BIT_A_WINDOW_START_MS * 1000UL) &&
+        inSecond < (int32_t)((BIT_A_WINDOW_END_MS + 1) * 1000UL)) {
+      this->bitAVote.add(samples, highSamples);
+      this->bitADecided =
+          this->bitThreshold.vote_decided(this->bitAVote.get_high(), this->bitAVote.get_total());
+    } else if (PROTOCOL::HAS_BIT_B && inSecond >= (int32_t)(BIT_B_WINDOW_START_MS * 1000UL) &&
+               inSecond < (int32_t)((BIT_B_WINDOW_END_MS + 1) * 1000UL)) {
+      this->bitBVote.add(samples, highSamples);
+      this->bitBDecided =
+          this->bitThreshold.vote_decided(this->bitBVote.get_high(), this->bitBVote.get_total());
+    } else if (this->currentSecond != PROTOCOL::NO_KNOWN_SILENCE_SECOND &&
+               inSecond >= (int32_t)(KNOWN_SILENCE_START_MS * 1000UL) &&
+               inSecond < (int32_t)((KNOWN_SILENCE_END_MS + 1) * 1000UL)) {
+      this->bitThreshold.add(true, binaryState);
+    } else if (this->currentSecond != PROTOCOL::NO_KNOWN_CARRIER_SECOND &&
+               inSecond >= (int32_t)(KNOWN_CARRIER_START_MS * 1000UL) &&
+               inSecond < (int32_t)((KNOWN_CARRIER_END_MS + 1) * 1000UL)) {
+      this->bitThreshold.add(false, binaryState);
+    }
+
+    this->nextSampleAt = this->nextAcquireSampleTime(now);
+  }
+
+  /// @brief Decodes the captured minute and either finishes, or in tracking
+  /// mode carries on with the next minute
+  /// @param now Timestamp of the last sample in microseconds
+  void finishMinute(uint32_t now) {
+    this->enterState(MSFState::DECODE, now);
+    this->decode();
+    // we are locked to the right marker, the other candidates are stale now
+    if (this->result.checksumPassed) {
+      this->syncCandidates.reset(LOOKBACK_TOTAL);
+      this->locked = true;
+      this->referenceTime = this->result;
+      this->referenceMinuteStart = this->lockedMinuteStart();
+    }
+
+    // every parity group knows what part of the time code it covers, a time
+    // code without parity passes them all
+    uint8_t failedGroups = ParityGroups::failed(this->frame);
+    uint8_t failedParts = ParityGroups::covered(failedGroups);
+    MSFParityEvent parity;
+    parity.yearOk = !(failedParts & MSFSignalQuality::YEAR_PARITY);
+    parity.dateOk = !(failedParts & MSFSignalQuality::DATE_PARITY);
+    parity.dayOfTheWeekOk = !(failedParts & MSFSignalQuality::DAY_OF_THE_WEEK_PARITY);
+    parity.timeOk = !(failedParts & MSFSignalQuality::TIME_PARITY);
+    parity.corrected = this->result.checksumPassed && failedGroups != 0;
+    parity.combinedMinutes = 0;
+    this->quality.failedParityGroups = failedParts;
+
+    // single minute was not good enough, see if it is together with the
+    // previous ones
+    this->softAccumulator.add(this->softFrame);
+    if (!this->result.checksumPassed && this->softAccumulator.get_count() > 1) {
+      MSFData combined = this->softAccumulator.decode();
+      if (combined.checksumPassed) parity.combinedMinutes = this->softAccumulator.get_count();
+      MSF_TIME_LIB_LOG(F("[MSF] Combining last "));
+      MSF_TIME_LIB_LOG(this->softAccumulator.get_count());
+      MSF_TIME_LIB_LOG(F(" minutes: "));
+      MSF_TIME_LIB_LOGLN(combined.checksumPassed ? F("OK") : F("FAILED"));
+      if (combined.checksumPassed) {
+        // bits without parity are not kept across minutes, we can only take
+        // them from the newest one
+        PROTOCOL::decode_unprotected(this->frame, combined);
+        this->result = combined;
+      }
+    }
+    parity.checksumPassed = this->result.checksumPassed;
+    OBSERVER::on_parity(parity);
+    if (this->firstAcquiredSecond > PROTOCOL::DUT1_FIRST_SECOND)
+      this->result.dut1Valid = false;
+    this->result.minuteEdgeMicros = this->fittedMinuteEdge(this->result.minuteEdgeErrorMicros);
+    this->result.quality = this->finishedQuality();
+    this->resetQuality();
+    this->newResult = true;
+    if (this->tracking)
+      this->enterVerify(now);
+    else
+      this->enterState(MSFState::READY, now);
+  }
+
+  /// @brief Returns the last second of the minute we sample, the minute check
+  /// is done with the parity bit and does not need the rest
+  int lastAcquiredSecond() const { return this->checking ? CHECKED_PARITY_SECOND : LAST_SECOND; }
+
+  /// @brief Compares the bits sampled by the minute check with the ones we
+  /// predicted, every single one has to match
+  bool matchesCheckTime() const {
+    MSFFrame expected;
+    PROTOCOL::encode(this->checkTime, expected);
+    for (int second = FIRST_CHECKED_SECOND; second <= LAST_CHECKED_A_SECOND; second++) {
+      if (this->frame.a(second) != expected.a(second)) return false;
+    }
+    if (!PROTOCOL::CHECKED_PARITY_IN_B)
+      return this->frame.a(CHECKED_PARITY_SECOND) == expected.a(CHECKED_PARITY_SECOND);
+    return this->frame.b(CHECKED_PARITY_SECOND) == expected.b(CHECKED_PARITY_SECOND);
+  }
+
+  /// @brief Finishes the minute check, if the prediction was right the
+  /// predicted time becomes the result and the new reference, otherwise we
+  /// dont trust our lock anymore
+  /// @param now Current timestamp in microseconds
+  /// @param checkOutcome Outcome of the check
+  void finishCheck(uint32_t now, MSFCheckResult checkOutcome) {
+    MSF_TIME_LIB_LOG(F("[MSF] Minute check: "));
+    MSF_TIME_LIB_LOGLN(checkOutcome == MSFCheckResult::CONFIRMED ? F("CONFIRMED") : F("FAILED"));
+    this->enterState(MSFState::READY, now);
+    this->checkResult = checkOutcome;
+    if (checkOutcome == MSFCheckResult::CONFIRMED) {
+      this->result = this->checkTime;
+      this->result.checksumPassed = true;
+      this->result.minuteEdgeMicros = this->fittedMinuteEdge(this->result.minuteEdgeErrorMicros);
+      this->result.quality = this->finishedQuality();
+      this->referenceTime = this->checkTime;
+      this->referenceMinuteStart = this->lockedMinuteStart();
+      this->locked = true;
+    } else {
+      this->locked = false;
+    }
+    this->newResult = true;
+    this->resetQuality();
+  }
+
+  /// @brief Returns the timestamp at which the state machine has to run next,
+  /// either to take a sample or because the state has a deadline
+  uint32_t nextEventAt() const {
+    switch (this->state) {
+      case MSFState::SLEEP:
+        return this->stateStartedAt + this->sleepDuration;
+      case MSFState::ALIGN:
+        return this->minuteStart - MINUTE_EDGE_SEARCH_BEFORE_US;
+      default:
+        return this->nextSampleAt;
+    }
+  }
+
+  /// @brief Runs the state machine for the event scheduled by nextEventAt(),
+  /// the carrier state is ignored if the state does not need a sample
+  /// @param now Timestamp of the event in microseconds
+  /// @param carrier Carrier state at the time of the event
+  void runEvent(uint32_t now, bool carrier) {
+    switch (this->state) {
+      case MSFState::SLEEP:
+        this->enterSync(now);
+        break;
+      case MSFState::SYNC:
+        this->syncSample(now, carrier);
+        break;
+      case MSFState::VERIFY:
+        this->verifySample(now, carrier);
+        break;
+      case MSFState::ALIGN:
+        this->enterAcquire(now);
+        break;
+      case MSFState::ACQUIRE:
+        this->acquireSample(now, carrier);
+        break;
+      default:
+        break;
+    }
+  }
+
+  /// @brief Checks if the current state reads the carrier on its events
+  bool needsSample() const {
+    return this->state == MSFState::SYNC || this->state == MSFState::VERIFY ||
+           this->state == MSFState::ACQUIRE;
+  }
+
+  /// @brief Checks if the state machine has any events to run
+  bool isRunning() const {
+    return this->state != MSFState::IDLE && this->state != MSFState::READY &&
+           this->state != MSFState::DECODE;
+  }
+
+  /// @brief Consumes all edges from the edge buffer that happened up to given
+  /// time, keeping track of the carrier state at that time
+  /// @param until Timestamp in microseconds to consume the edges up to
+  void consumeEdgesUntil(uint32_t until) {
+    uint32_t edgeTimestamp;
+    bool edgeCarrier;
+    while (this->edgeSource->peek(edgeTimestamp, edgeCarrier) &&
+           (int32_t)(edgeTimestamp - until) <= 0) {
+      this->edgeSource->pop();
+      edgeCarrier = edgeCarrier != PROTOCOL::INVERTED;
+      if (this->edgeLevel && !edgeCarrier) this->lastCarrierOffEdge = edgeTimestamp;
+      this->edgeLevel = edgeCarrier;
+    }
+  }
+
+  /// @brief Takes the vote on the samples accumulated in Bit A and Bit B
+  /// windows of current second and stores the resulting bits into the frame
+  void storeCurrentSecond() {
+    // if more than threshold (60% until we learn better, see MSFBitThreshold)
+    // of the samples in the window are high, we consider the bit to be 1,
+    // otherwise 0
+    // (or the other way round for the bits carried by the carrier, see
+    // MSFProtocol.h)
+    uint8_t threshold = this->bitThreshold.get_percent();
+    bool valA = this->bitAVote.is_over(threshold) != PROTOCOL::BIT_A_INVERTED;
+    bool valB =
+        PROTOCOL::HAS_BIT_B && this->bitBVote.is_over(threshold) != PROTOCOL::BIT_B_INVERTED;
+    this->frame.set_a(this->currentSecond, valA);
+    this->frame.set_b(this->currentSecond, valB);
+    int8_t confidenceA = this->bitAVote.get_confidence(threshold);
+    int8_t confidenceB = PROTOCOL::HAS_BIT_B ? this->bitBVote.get_confidence(threshold) : 0;
+    if (PROTOCOL::BIT_A_INVERTED) confidenceA = -confidenceA;
+    if (PROTOCOL::BIT_B_INVERTED) confidenceB = -confidenceB;
+    this->softFrame.set(this->currentSecond, confidenceA, confidenceB);
+    this->bitThreshold.update();
+
+    this->bitMarginSum += abs(confidenceA) + abs(confidenceB);
+    this->bitMarginCount += PROTOCOL::HAS_BIT_B ? 2 : 1;
+    if (this->bitAVote.is_mixed()) this->quality.noisySeconds++;
+
+    // the percentages are only there for the observer, without one the
+    // compiler drops them
+    MSFSecondEvent event;
+    event.second = this->currentSecond;
+    event.a = valA;
+    event.b = valB;
+    event.percentA = this->bitAVote.get_percent();
+    event.percentB = this->bitBVote.get_percent();
+    event.samplesA = this->bitAVote.get_total();
+    event.samplesB = this->bitBVote.get_total();
+    event.threshold = threshold;
+    event.edgeErrorUs = this->lastSecondEdgeError;
+    OBSERVER::on_second(event);
+  }
+
+  /// @brief Decodes the captured frame into MSFData result, if the checksum
+  /// does not pass we try to correct single bit errors in the failing parity
+  /// groups, see correctParityGroup()
+  void decode() {
+    this->result = PROTOCOL::decode(this->frame);
+    if (this->result.checksumPassed) return;
+
+    // with more than one failing group the minute is too noisy to guess
+    // which bits are wrong, decoding it together with the next minutes is a
+    // better bet
+    uint8_t failedGroups = ParityGroups::failed(this->frame);
+    if (failedGroups == 0 || (failedGroups & (failedGroups - 1)) != 0) return;
+
+    // the bits as they were received stay in frame, we only decode the copy
+    MSFFrame candidate = this->frame;
+    MSFParitySpan group;
+    ParityGroups::get(__builtin_ctz(failedGroups), group);
+    if (!this->correctParityGroup(group, candidate)) return;
+
+    // only take the corrected result if everything passes
+    MSFData correctedResult = PROTOCOL::decode(candidate);
+    MSF_TIME_LIB_LOG(F("[MSF] Parity correction "));
+    MSF_TIME_LIB_LOGLN(correctedResult.checksumPassed ? F("OK") : F("FAILED"));
+    if (correctedResult.checksumPassed) this->result = correctedResult;
+  }
+
+  /// @brief Flips the least confident bit of a parity group that failed. With
+  /// a single bit error the parity can not tell us which bit it was, but the
+  /// share of high samples in its window most likely can, as long as it is the
+  /// only bit of the group we were unsure about.
+  /// @param group Parity group that failed, see MSFParityGroups
+  /// @param candidate Frame to flip the bit in
+  /// @return True if a bit was flipped, false if we could not tell which one
+  /// to flip
+  bool correctParityGroup(const MSFParitySpan& group, MSFFrame& candidate) {
+    const int parityBitIdx = group.parityBit;
+    int8_t leastConfidence =
+        abs(group.parityInB ? this->softFrame.b(parityBitIdx) : this->softFrame.a(parityBitIdx));
+    int leastConfidentIdx = -1;
+    int unsureBits = (leastConfidence <= MAX_CORRECTED_BIT_CONFIDENCE) ? 1 : 0;
+    for (int i = group.startBit; i < group.startBit + group.numBits; i++) {
+      int8_t confidence = abs(this->softFrame.a(i));
+      if (confidence <= MAX_CORRECTED_BIT_CONFIDENCE) unsureBits++;
+      if (confidence < leastConfidence) {
+        leastConfidence = confidence;
+        leastConfidentIdx = i;
+      }
+    }
+    if (unsureBits != 1) return false;
+
+    MSF_TIME_LIB_LOG(F("[MSF] Parity failed, flipping "));
+    if (leastConfidentIdx < 0 && group.parityInB) {
+      MSF_TIME_LIB_LOG(F("B"));
+      MSF_TIME_LIB_LOGLN(parityBitIdx);
+      candidate.set_b(parityBitIdx, !candidate.b(parityBitIdx));
+    } else {
+      if (leastConfidentIdx < 0) leastConfidentIdx = parityBitIdx;
+      MSF_TIME_LIB_LOG(F("A"));
+      MSF_TIME_LIB_LOGLN(leastConfidentIdx);
+      candidate.set_a(leastConfidentIdx, !candidate.a(leastConfidentIdx));
+    }
+    return true;
   }
 
  public:
+  /// @brief SRAM taken by the minute marker rolling buffer in bytes, which is
+  /// the only part of the receiver that depends on SAMPLE_RATE_MS and
+  /// DECIMATION. Use sizeof() on the receiver type for the whole footprint.
+  static constexpr size_t ROLLING_BUFFER_SRAM_BYTES = MINUTE_MARKER_LOOKUP_BUFFER_SIZE_IN_BYTES;
+
   /// @brief Initializes the MSFReceiver with a reader function that reads the
   /// current state of the carrier
   /// @param readerFunc A function pointer provided by the user code that reads
   /// the current state of the carrier (true for carrier, false for silence).
   MSFReceiver(ReaderFunction readerFunc) : carrierStateReader(readerFunc) {}
 
-  /// @brief Reads the MSF signal and outputs the decoded time and checksum
-  /// result.
-  /// @return Struct containing decoded time and checksum result.
-  MSFData get_time() {
-    uint32_t minuteStart = this->get_next_bit_retrieval_timestamp();
-    // TODO: Instead of relying on calculating offsets from 0th second, we can
-    // detect the second boundary by 700ms of carrier followed by 100ms of
-    // silence in every second
-    uint32_t nextSecondBoundary = 1000;
-
-    // Reset Member Variables
-    memset(this->packedABits, 0, sizeof(this->packedABits));
-    memset(this->packedBBits, 0, sizeof(this->packedBBits));
+  /// @brief Initializes the MSFReceiver with a READER that knows where to
+  /// read the carrier on its own, e.g. MSFPinReader reading the pin register
+  MSFReceiver() {
+    // the default reader would call a null function on the first tick()
+    static_assert(!MSFReaderNeedsFunction<READER>::value,
+                  "MSFReceiver needs a reader function, an edge or a sample buffer");
+    this->diversity.set_inputs(READER::INPUTS);
+  }
 
-    MSF_TIME_LIB_LOG(F("[MSF] Sync Complete. Aligning to next minute (Will wait for: "));
-    MSF_TIME_LIB_LOG((minuteStart - millis()));
-    MSF_TIME_LIB_LOGLN(F("ms)..."));
+  /// @brief Initializes the MSFReceiver with several receiver modules (or
+  /// antennas) read at the same time. Every read goes to all of them and
+  /// their votes are weighted by how well each one scored on the minute
+  /// marker, so a module in an orientation null does not spoil the minute.
+  /// Set MSF_TIME_LIB_DIVERSITY_INPUTS to the number of modules before
+  /// including the library, see MSFDiversity.
+  /// @param readerFuncs Reader functions of the modules, the array has to
+  /// outlive the receiver
+  /// @param count Number of reader functions, the ones past
+  /// MSF_TIME_LIB_DIVERSITY_INPUTS are ignored
+  MSFReceiver(const ReaderFunction* readerFuncs, uint8_t count)
+      : carrierStateReader(readerFuncs, count) {
+    this->diversity.set_inputs(this->carrierStateReader.get_count());
+  }
 
-    // 3. WAIT
-    while (millis() < minuteStart) {
-      delay(1);
+  /// @brief Initializes the MSFReceiver in edge capture mode, where the carrier
+  /// is not polled but reconstructed from transitions pushed into the edge
+  /// buffer by pin change interrupt, see MSFEdgeBuffer::push()
+  /// @param edges Edge buffer filled by the pin change interrupt of the
+  /// receiver module input pin
+  MSFReceiver(MSFEdgeBuffer& edges) : edgeSource(&edges) {}
+
+  /// @brief Initializes the MSFReceiver in block sampling mode, where the
+  /// carrier is sampled by a timer or DMA into the sample buffer and tick()
+  /// takes the samples from its blocks, see MSFSampleBuffer
+  /// @param samples Sample buffer filled at a fixed rate from the receiver
+  /// module input pin
+  MSFReceiver(MSFSampleBuffer& samples) : sampleSource(&samples) {}
+
+  /// @brief Starts a new non-blocking time acquisition. After calling this,
+  /// keep calling tick() from your main loop until it returns true.
+  void start() {
+    this->tracking = false;
+    this->checking = false;
+    this->newResult = false;
+    this->softAccumulator.reset();
+    this->resetQuality();
+    if (this->restoredLock) {
+      MSF_TIME_LIB_LOGLN(F("[MSF] Restored lock state, checking the minute marker..."));
+      this->restoredLock = false;
+      this->locked = false;
+      this->verifyPredictedMinute(micros());
+      return;
     }
-    MSF_TIME_LIB_LOGLN(F("[MSF] Starting decode NOW."));
+    this->enterSleep(micros());
+  }
 
-    MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
-    MSF_TIME_LIB_LOGLN(F("[MSF] SEC |   BIT A (135-165ms)   |   BIT B (235-265ms)"));
-    MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
+  /// @brief Starts continuous non-blocking time acquisition. The first minute
+  /// is acquired the same way as with start(), but after that the receiver
+  /// carries on decoding every following minute back to back, only checking
+  /// the minute marker is where we expect it instead of scanning for it again.
+  /// tick() returns true once for every decoded minute. If the marker is lost
+  /// the receiver syncs again on its own. Call stop() to end it.
+  void start_tracking() {
+    this->start();
+    this->tracking = true;
+  }
 
-    int countOfHighBitASamples = 0, totalCountOfBitASamples = 0;
-    int countOfHighBitBSamples = 0, totalCountOfBitBSamples = 0;
-    int currentSecond = 0;
-    while (currentSecond < 60) {
-      uint32_t elapsedMs = millis() - minuteStart;
-
-      if (true)  // read as often as possible by hardware
-      {
-        // delay to max of cca 2kHz sampling, minus some processing overhead,
-        // just in case read makes an RF spike in hardware and to make sure our
-        // count variables dont overflow
-        delayMicroseconds(500);
-
-        int currentMsInCurrentSecond = elapsedMs % 1000;
-        // MSF spec defines presence of carrier as binary 0 and absence of
-        // carrier (silence) as binary 1 we invert the carrier state here to
-        // make it more intuitive to work with, where 1 means presence of
-        // carrier and 0 means silence
-        bool carrierState = this->carrierStateReader();
-        bool binaryState = !carrierState;
-
-        // Accumulate data if we are inside the specific windows for Bit A or
-        // Bit B we read multiple time in the window to be more resilient and
-        // later we will take vote based on percentage of samples
-        if (currentMsInCurrentSecond >= 135 && currentMsInCurrentSecond <= 165) {
-          totalCountOfBitASamples++;
-          if (binaryState) countOfHighBitASamples++;
-        } else if (currentMsInCurrentSecond >= 235 && currentMsInCurrentSecond <= 265) {
-          totalCountOfBitBSamples++;
-          if (binaryState) countOfHighBitBSamples++;
-        }
-      }
+  /// @brief Stops any acquisition in progress, the last result stays
+  /// available via get_result()
+  void stop() {
+    this->tracking = false;
+    this->checking = false;
+    this->enterState(MSFState::IDLE, micros());
+  }
+
+  /// @brief Starts a non-blocking minute check. Instead of acquiring the whole
+  /// minute we predict the time of the next one from the last decoded (or
+  /// restored) time and only check the minute marker, the minute bits (Bit A
+  /// of seconds 45 to 51) and their parity (Bit B of second 57). The receiver
+  /// only needs to be on for cca 10 seconds of the minute, and with
+  /// MSFLowPowerScheduler the MCU sleeps the rest of the time. tick() returns
+  /// true once the check is done, see get_check_result(). A confirmed check
+  /// updates get_result() to the checked minute, any other outcome drops the
+  /// lock and you need to acquire the time again with start().
+  ///
+  /// The check can not see the hour, so it is refused while the last time we
+  /// know warns about summer time change. Make sure to acquire the whole
+  /// minute at least once an hour around the change, see
+  /// MSFData::summerTimeWarning.
+  /// @return False if there is no lock to check, start() has to be used
+  bool start_minute_check() {
+    if (!this->locked && !this->restoredLock) return false;
+    if (this->referenceTime.summerTimeWarning) return false;
+    this->restoredLock = false;
+    this->tracking = false;
+    this->newResult = false;
+    this->checking = true;
+    this->checkResult = MSFCheckResult::NONE;
+    this->resetQuality();
+    MSF_TIME_LIB_LOGLN(F("[MSF] Checking the next minute..."));
+    this->verifyPredictedMinute(micros());
+    return true;
+  }
 
-      // 2. PROCESS & STORE (End of Second)
-      // Check if we crossed the 1000ms boundary. If so, calculate the final bit
-      // for the second.
-      if (elapsedMs >= nextSecondBoundary) {
-        int percentageOfHighASamples =
-            (totalCountOfBitASamples > 0) ? (countOfHighBitASamples * 100) / totalCountOfBitASamples
-                                          : 0;
-        int percentageOfHighBitBSamples =
-            (totalCountOfBitBSamples > 0) ? (countOfHighBitBSamples * 100) / totalCountOfBitBSamples
-                                          : 0;
-
-        bool valA =
-            (percentageOfHighASamples > 60);  // if more than 60% of the samples in bit A window
-                                              // are high, we consider the bit to be 1, otherwise 0
-        bool valB = (percentageOfHighBitBSamples >
-                     60);  // if more than 60% of the samples in bit B window
-                           // are high, we consider the bit to be 1, otherwise 0
-        this->writeBit(this->packedABits, currentSecond,
-                       valA);  // if more than 60% of the samples in bit A window are high,
-                               // we consider the bit to be 1, otherwise 0
-        this->writeBit(this->packedBBits, currentSecond,
-                       valB);  // if more than 60% of the samples in bit B window are high,
-                               // we consider the bit to be 1, otherwise 0
-
-        MSF_TIME_LIB_LOG(F("[MSF] Sec "));
-        if (currentSecond < 10) MSF_TIME_LIB_LOG(F("0"));
-        MSF_TIME_LIB_LOG(currentSecond);
-        MSF_TIME_LIB_LOG(F(" | A:"));
-        MSF_TIME_LIB_LOG((valA) ? F("1") : F("0"));
-        MSF_TIME_LIB_LOG(F(" ["));
-        MSF_TIME_LIB_LOG(percentageOfHighASamples);
-        MSF_TIME_LIB_LOG(F("%]"));
-        MSF_TIME_LIB_LOG(F(" | B:"));
-        MSF_TIME_LIB_LOG((valB) ? F("1") : F("0"));
-        MSF_TIME_LIB_LOG(F(" ["));
-        MSF_TIME_LIB_LOG(percentageOfHighBitBSamples);
-        MSF_TIME_LIB_LOG(F("%]"));
-
-        if (percentageOfHighASamples < 90 && percentageOfHighASamples > 10)
-          MSF_TIME_LIB_LOG(F(" <--- NOISY"));
-        MSF_TIME_LIB_LOGLN();
-
-        // Prepare for next second
-        currentSecond++;
-        nextSecondBoundary += 1000;
-        countOfHighBitASamples = 0;
-        totalCountOfBitASamples = 0;
-        countOfHighBitBSamples = 0;
-        totalCountOfBitBSamples = 0;
+  /// @brief Returns the outcome of the last minute check, see
+  /// start_minute_check()
+  MSFCheckResult get_check_result() const { return this->checkResult; }
+
+  /// @brief Checks if the receiver is in tracking mode, see start_tracking()
+  bool is_tracking() const { return this->tracking; }
+
+  /// @brief Saves where the minute marker is and how fast the local clock
+  /// runs, so the receiver can be restored after reset or deep sleep with
+  /// restore_lock_state(). Only available once a minute decoded with passing
+  /// checksum and until the marker is lost. The phase is counted on our local
+  /// clock from the last minute we decoded, so save it within the hour.
+  /// @param state Output, the state to keep in RTC memory or EEPROM
+  /// @return False if there is no lock to save
+  bool get_lock_state(MSFLockState& state) const {
+    if (!this->locked) return false;
+    // the struct goes to EEPROM as it is, so clear the padding too
+    memset(static_cast<void*>(&state), 0, sizeof(state));
+    state.magic = MSFLockState::MAGIC;
+    uint32_t sinceReference = this->localToRealTime(micros() - this->referenceMinuteStart);
+    state.minutePhase = sinceReference % 60000000UL;
+    state.secondPeriodCorrection = this->secondPeriodCorrection;
+    state.minuteTime = this->referenceTime;
+    state.minuteTime.add_minutes(sinceReference / 60000000UL);
+    state.checksum = state.calculate_checksum();
+    return true;
+  }
+
+  /// @brief Restores the state saved by get_lock_state(). The next start()
+  /// (or get_time() and get_time_with_retry()) skips the back-off sleep and
+  /// the 65s scan and only checks the minute marker where the state says it
+  /// should be, just like tracking mode does every minute. If it is not there
+  /// the receiver falls back to the scan.
+  /// @param state State saved by get_lock_state()
+  /// @param elapsedMs Time since get_lock_state() was called, e.g. the deep
+  /// sleep duration plus the boot time, measured by RTC or anything else that
+  /// keeps running through the reset. It has to be accurate to cca 100ms,
+  /// otherwise we miss the marker.
+  /// @return False if the state is not valid and was ignored
+  bool restore_lock_state(const MSFLockState& state, uint32_t elapsedMs) {
+    if (!state.is_valid()) return false;
+
+    this->secondPeriodCorrection = state.secondPeriodCorrection;
+    if (this->secondPeriodCorrection > MAX_SECOND_PERIOD_CORRECTION_US)
+      this->secondPeriodCorrection = MAX_SECOND_PERIOD_CORRECTION_US;
+    if (this->secondPeriodCorrection < -MAX_SECOND_PERIOD_CORRECTION_US)
+      this->secondPeriodCorrection = -MAX_SECOND_PERIOD_CORRECTION_US;
+
+    // elapsed time can be anything, so whole minutes go to the time and only
+    // the phase within the minute is converted to our clock
+    uint32_t phase = state.minutePhase + (elapsedMs % 60000UL) * 1000UL;
+    this->referenceTime = state.minuteTime;
+    this->referenceTime.add_minutes(elapsedMs / 60000UL + phase / 60000000UL);
+    this->referenceMinuteStart = micros() - this->realToLocalTime(phase % 60000000UL);
+    this->restoredLock = true;
+    return true;
+  }
+
+  /// @brief Configures when the minute marker scan can finish before the full
+  /// 65s. Once the best score reaches given percentage of the perfect score
+  /// and is not beaten for the confirmation time the scan stops and we align
+  /// to the next minute straight away. Normal seconds can hardly score over
+  /// 80% so the default of 95% and 1000ms is safe on clean signal, lower the
+  /// threshold only if you know what you are doing.
+  /// @param confidencePercent Percentage of the perfect score (0-100), 0
+  /// disables early exit and always scans for 65s
+  /// @param confirmationMs How long the peak must stay the best one
+  void set_sync_early_exit(uint8_t confidencePercent, uint16_t confirmationMs) {
+    if (confidencePercent > 100) confidencePercent = 100;
+    this->syncEarlyExitScore = (int32_t)LOOKBACK_TOTAL * confidencePercent / 100;
+    this->syncConfirmationTime = confirmationMs * 1000UL;
+  }
+
+  /// @brief Advances the acquisition state machine
+  /// (SLEEP -> SYNC -> ALIGN -> ACQUIRE -> DECODE -> READY) and returns
+  /// immediately. With a reader function this takes at most one sample per
+  /// call, so call it as often as possible, at least every SAMPLE_RATE_MS while
+  /// syncing and every ~0.5ms while acquiring bits. In edge capture mode this
+  /// catches up on everything that happened since the last call in one go, so
+  /// it is enough to call it every few hundred milliseconds. In block sampling
+  /// mode it catches up on the blocks sampled since the last call, call it
+  /// once per block.
+  /// @return True when the result is ready and can be read with get_result().
+  /// In tracking mode the state machine never stops, so this returns true only
+  /// from the call that decoded a new minute.
+  bool tick() {
+    uint32_t now = micros();
+    this->newResult = false;
+
+    if (this->edgeSource) {
+      // replay the captured edges, running every event that was due since the
+      // last call at its exact timestamp
+      while (this->isRunning() && (int32_t)(now - this->nextEventAt()) >= 0) {
+        uint32_t eventAt = this->nextEventAt();
+        this->consumeEdgesUntil(eventAt);
+        this->runEvent(eventAt, this->edgeLevel);
       }
+      this->consumeEdgesUntil(now);
+    } else if (this->sampleSource) {
+      // the same with the sampled blocks, up to the first event whose block
+      // is not complete yet
+      bool carrier = true;
+      while (this->isRunning() && (int32_t)(now - this->nextEventAt()) >= 0) {
+        uint32_t eventAt = this->nextEventAt();
+        if (this->needsSample() && !this->sampleSource->carrier_at(eventAt, carrier)) break;
+        this->runEvent(eventAt, carrier != PROTOCOL::INVERTED);
+      }
+      // the next event is still ahead, so it only needs samples from the
+      // block in progress on, drop the older ones before they fill the buffer
+      // while we sleep, align or wait for the next bit window
+      this->sampleSource->drop_until(now);
+    } else if (this->isRunning() && (int32_t)(now - this->nextEventAt()) >= 0) {
+      this->runEvent(now, this->needsSample() ? this->readCarrier() : true);
     }
-    MSF_TIME_LIB_LOGLN(F("[MSF] ------------------------------------------------"));
 
-    // 3. DECODE
-    MSFData result;
-
-    static const int wYear[] = {80, 40, 20, 10, 8, 4, 2, 1};
-    static const int wMonth[] = {10, 8, 4, 2, 1};
-    static const int wDay[] = {20, 10, 8, 4, 2, 1};
-    static const int wDOW[] = {4, 2, 1};
-    static const int wHour[] = {20, 10, 8, 4, 2, 1};
-    static const int wMin[] = {40, 20, 10, 8, 4, 2, 1};
-
-    int rawYear = this->decodeBCD(17, 8, wYear);
-    result.year += rawYear;
-    result.month = this->decodeBCD(25, 5, wMonth);
-    result.day = this->decodeBCD(30, 6, wDay);
-    result.hour = this->decodeBCD(39, 6, wHour);
-    result.minute = this->decodeBCD(45, 7, wMin);
-    result.dayOfTheWeek = this->decodeBCD(36, 3, wDOW) + 1;
-
-    // each piece of information has its own parity bit as in MSF spec
-    bool pYear =
-        this->checkParity(17, 8, 54);  // year is located from bit 17 to bit 24 in packedABits,
-                                       // and its parity bit is located at bit 54 in packedBBits
-    bool pDate = this->checkParity(25, 11, 55);  // date (month, day, dow) is located from bit 25 to
-                                                 // bit 35 in packedABits, and its parity bit is
-                                                 // located at bit 55 in packedBBits
-    bool pDOW =
-        this->checkParity(36, 3,
-                          56);  // day of week is located from bit 36 to bit 38 in packedABits,
-                                // and its parity bit is located at bit 56 in packedBBits
-    bool pTime = this->checkParity(39, 13, 57);  // time (hour, minute) is located from bit 39 to
-                                                 // bit 51 in packedABits, and its parity bit is
-                                                 // located at bit 57 in packedBBits
-
-    bool sane = (result.month >= 1 && result.month <= 12) &&
-                (result.day >= 1 && result.day <= 31) && (result.hour <= 23) &&
-                (result.minute <= 59);
-
-    result.checksumPassed = pYear && pDate && pDOW && pTime && sane;
-
-    return result;
+    return this->newResult || this->state == MSFState::READY;
+  }
+
+  /// @brief Checks whether the last started acquisition finished.
+  /// @return True when the result is ready and can be read with get_result().
+  bool is_ready() const { return this->state == MSFState::READY; }
+
+  /// @brief Returns the result of last finished acquisition, only valid once
+  /// is_ready() returns true. Check checksumPassed before using the data and
+  /// call start() again if it did not pass.
+  /// @return Struct containing decoded time and checksum result.
+  const MSFData& get_result() const { return this->result; }
+
+  /// @brief Returns the current state of the acquisition state machine.
+  MSFState get_state() const { return this->state; }
+
+  /// @brief Returns how much the vote trusts given receiver module, from 0
+  /// for one without signal to 29 for a perfect one. Only the receiver built
+  /// with several reader functions has weights, see MSFDiversity.
+  /// @param input Index of the reader function
+  uint8_t get_input_weight(uint8_t input) const { return this->diversity.get_weight(input); }
+
+  /// @brief Returns how long the state machine can be left alone until it
+  /// needs the next tick(), this is what MSFLowPowerScheduler uses to decide
+  /// how long to sleep. While syncing this is the sample interval, while
+  /// acquiring bits this is the time until the next Bit A/B window or second
+  /// boundary and while aligning this is the time until the minute starts. In
+  /// block sampling mode the sample of an event is there once the block
+  /// holding it is complete, so this is never less than the time until the
+  /// next block.
+  /// @return Time in microseconds until the next event, 0 if it is already due
+  /// or nothing is running.
+  uint32_t get_time_until_next_event() const {
+    if (!this->isRunning()) return 0;
+    uint32_t eventAt = this->nextEventAt();
+    // in block sampling mode the sample of the event comes with the block
+    // holding it, there is nothing to do until that one is complete
+    uint32_t sampledUntil;
+    if (this->sampleSource && this->needsSample() && this->sampleSource->get_end(sampledUntil) &&
+        (int32_t)(eventAt - sampledUntil) >= 0) {
+      uint32_t nextBlockAt = sampledUntil + this->sampleSource->get_block_duration();
+      if ((int32_t)(nextBlockAt - eventAt) > 0) eventAt = nextBlockAt;
+    }
+    int32_t remaining = (int32_t)(eventAt - micros());
+    return remaining > 0 ? remaining : 0;
+  }
+
+  /// @brief Reads the MSF signal and outputs the decoded time and checksum
+  /// result. This blocks for 66 to 130 seconds, use start() and tick() if you
+  /// need to do something else in the meantime.
+  /// @return Struct containing decoded time and checksum result.
+  MSFData get_time() {
+    this->start();
+    this->waitForResult();
+    return this->result;
+  }
+
+  /// @brief Checks the next minute is what we predict from the last decoded
+  /// time, blocking for up to 2 minutes, see start_minute_check()
+  /// @return Outcome of the check, MSFCheckResult::NONE if there is no lock to
+  /// check
+  MSFCheckResult check_time() {
+    if (!this->start_minute_check()) return MSFCheckResult::NONE;
+    this->waitForResult();
+    return this->checkResult;
   }
 
   /// @brief Reads the MSF signal and outputs the decoded time and checksum
   /// result, with keep blocking and retrying until checksum is passed and we
-  /// have a valid time.
+  /// have a valid time. Retries run in tracking mode, so a failed checksum
+  /// only costs the next minute instead of a new sync.
   /// @return Struct containing decoded time and checksum result.
   MSFData get_time_with_retry() {
+    MSF_TIME_LIB_LOGLN(F("\n[MSF] Attempting to acquire atomic time..."));
+    this->start_tracking();
     while (true) {
-      MSF_TIME_LIB_LOGLN(F("\n[MSF] Attempting to acquire atomic time..."));
-      MSFData res = this->get_time();
+      this->waitForResult();
 
-      if (res.checksumPassed) {
+      if (this->result.checksumPassed) {
         MSF_TIME_LIB_LOGLN(F("[MSF] SUCCESS! Checksum Passed."));
-        return res;
+        this->stop();
+        return this->result;
       } else {
         MSF_TIME_LIB_LOGLN(F("[MSF] Checksum Failed. Retrying..."));
       }
     }
   }
+
+ private:
+  /// @brief Returns the start of the minute we are locked to on our local
+  /// clock, counted back from the second we are in as that is the one we have
+  /// measured last
+  uint32_t lockedMinuteStart() const {
+    return this->secondStart - (1000000L + this->secondPeriodCorrection) * this->currentSecond;
+  }
+
+  /// @brief Converts time measured on our local clock to real time, using
+  /// what we learned about its drift
+  /// @param localTime Time in microseconds, up to cca an hour
+  uint32_t localToRealTime(uint32_t localTime) const {
+    return localTime - (int32_t)(localTime / 1000000UL) * this->secondPeriodCorrection;
+  }
+
+  /// @brief Converts real time to time on our local clock, see
+  /// localToRealTime()
+  /// @param realTime Time in microseconds, up to cca an hour
+  uint32_t realToLocalTime(uint32_t realTime) const {
+    return realTime + (int32_t)(realTime / 1000000UL) * this->secondPeriodCorrection;
+  }
+
+  /// @brief Enters the VERIFY state for the next minute marker predicted
+  /// from the reference, skipping the markers we are too late to check, and
+  /// predicts the time of that minute for the minute check
+  /// @param now Current timestamp in microseconds
+  void verifyPredictedMinute(uint32_t now) {
+    this->syncCandidates.reset(LOOKBACK_TOTAL);
+    this->softAccumulator.reset();
+
+    const uint32_t localMinute = this->realToLocalTime(60000000UL);
+    uint32_t minutes = (now + VERIFY_LEAD_US - this->referenceMinuteStart) / localMinute + 1;
+    this->checkTime = this->referenceTime;
+    this->checkTime.add_minutes(minutes);
+    this->verifyMinuteAt(now, this->referenceMinuteStart + minutes * localMinute);
+  }
+
+  /// @brief Reads the carrier state through READER, with several receiver
+  /// modules this is the weighted vote of all of them
+  bool readCarrier() {
+    static const uint8_t ALL_INPUTS = (1 << READER::INPUTS) - 1;
+    uint8_t reads = this->carrierStateReader.read();
+    if (PROTOCOL::INVERTED) reads = ~reads & ALL_INPUTS;
+    if (this->diversity.is_active()) return this->diversity.vote(reads);
+    return reads;
+  }
+
+  /// @brief Blocks until tick() reports a result
+  void waitForResult() {
+    while (!this->tick()) {
+      // SLEEP and ALIGN are just waiting for a deadline, there is nothing to
+      // sample so give the cpu back. Espressif platforms want it back while
+      // sampling too, otherwise their watchdog and Wi-Fi starve, use MSFTask
+      // there if you can.
+      if (this->state == MSFState::SLEEP || this->state == MSFState::ALIGN)
+        delay(1);
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+      else
+        yield();
+#endif
+    }
+  }
 };
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <Arduino.h>
+
+// How far ahead one side of the Bit A/B vote has to get before we stop
+// sampling the window, counted in samples of a 50/50 vote on a signal with 5%
+// of the reads flipped by noise. There every read on the right side makes the
+// vote 19 times more likely to be right, so 6 is plenty. Noisier signal needs
+// bigger lead, which is scaled by the noise we measure. Set to 0 to always
+// sample whole windows.
+#ifndef MSF_TIME_LIB_EARLY_STOP_LEAD
+#define MSF_TIME_LIB_EARLY_STOP_LEAD 6
+#endif
+
+/// @brief Learns the share of high (silence) reads at which a Bit A/B window
+/// is taken as 1. Every second has parts where we know the state: silence
+/// straight after the second edge and carrier after 300ms (500ms on the 0th
+/// second). How often the reader gets those right tells us how it is skewed,
+/// a receiver that stretches silence reads more highs in a 0 bit as well, so
+/// the threshold sits halfway between the two. Until we have seen enough of
+/// both the fixed 60% is used. How many of those reads are wrong also tells
+/// vote_decided() how far ahead the vote has to get before we can stop.
+///
+/// The counts are halved once they get big, so the threshold follows the
+/// receiver as the signal changes.
+class MSFBitThreshold {
+  static const uint8_t DEFAULT_PERCENT = 60;
+  // a receiver that bad would not decode anything anyway, and this keeps a
+  // few noisy reads of the known parts from pushing the threshold to the
+  // ends where a single noisy read flips the bit
+  static const uint8_t MIN_PERCENT = 25;
+  static const uint8_t MAX_PERCENT = 75;
+  static const uint16_t MIN_SAMPLES = 64;
+  static const uint16_t MAX_SAMPLES = 1024;
+  // how much bigger the lead has to be for the vote to be as sure as with 5%
+  // of noisy reads, times 4, for up to 0%, 5%, 10% ... 40% of noisy reads.
+  // Over that we never stop early. Until we have measured the noise we assume
+  // 15%.
+  static const uint8_t NOISE_STEP_PERCENT = 5;
+  static const uint8_t DEFAULT_NOISE_PERCENT = 15;
+
+  uint16_t silenceHigh = 0, silenceTotal = 0;
+  uint16_t carrierHigh = 0, carrierTotal = 0;
+  uint8_t percent = DEFAULT_PERCENT;
+  // lead the vote needs, in hundredths of a sample, 0 means never decided
+  uint16_t requiredLead = leadForNoise(DEFAULT_NOISE_PERCENT);
+
+  /// @brief Returns the lead the vote needs with given share of noisy reads,
+  /// in hundredths of a sample, 0 if we should never stop early
+  static uint16_t leadForNoise(uint32_t noisePercent) {
+    static const uint8_t LEAD_SCALE[] = {4, 4, 5, 7, 8, 11, 14, 19, 29};
+    uint32_t step = (noisePercent + NOISE_STEP_PERCENT - 1) / NOISE_STEP_PERCENT;
+    if (step >= sizeof(LEAD_SCALE)) return 0;
+    return MSF_TIME_LIB_EARLY_STOP_LEAD * 100U * LEAD_SCALE[step] / 4;
+  }
+
+ public:
+  /// @brief Forgets everything learned, back to the fixed 60%
+  void reset() {
+    this->silenceHigh = this->silenceTotal = 0;
+    this->carrierHigh = this->carrierTotal = 0;
+    this->update();
+  }
+
+  /// @brief Adds one read of a part of the second where we know the state
+  /// @param silenceExpected True if we know there is silence, false if carrier
+  /// @param high True if the read was high (silence)
+  void add(bool silenceExpected, bool high) {
+    uint16_t& total = silenceExpected ? this->silenceTotal : this->carrierTotal;
+    uint16_t& highs = silenceExpected ? this->silenceHigh : this->carrierHigh;
+    total++;
+    if (high) highs++;
+    if (total >= MAX_SAMPLES) {
+      total /= 2;
+      highs /= 2;
+    }
+  }
+
+  /// @brief Recalculates the threshold from the reads added so far, done
+  /// once a second so add() stays cheap
+  void update() {
+    if (this->silenceTotal < MIN_SAMPLES || this->carrierTotal < MIN_SAMPLES) {
+      this->percent = DEFAULT_PERCENT;
+      this->requiredLead = leadForNoise(DEFAULT_NOISE_PERCENT);
+      return;
+    }
+    uint32_t silencePercent = (uint32_t)this->silenceHigh * 100 / this->silenceTotal;
+    uint32_t carrierPercent = (uint32_t)this->carrierHigh * 100 / this->carrierTotal;
+    uint32_t halfway = (silencePercent + carrierPercent) / 2;
+    if (halfway < MIN_PERCENT) halfway = MIN_PERCENT;
+    if (halfway > MAX_PERCENT) halfway = MAX_PERCENT;
+    this->percent = halfway;
+    // average share of the reads that were wrong in the known parts
+    uint32_t noisePercent =
+        silencePercent > carrierPercent ? (100 - silencePercent + carrierPercent) / 2 : 50;
+    this->requiredLead = leadForNoise(noisePercent);
+  }
+
+  /// @brief Returns the share of high reads above which a window is 1, in
+  /// percent
+  uint8_t get_percent() const { return this->percent; }
+
+  /// @brief Checks if the vote in a bit window is already decided, so the
+  /// rest of the window does not have to be sampled. This is a sequential
+  /// probability ratio test, every high read counts for the bit being 1 and
+  /// every low one against it, weighted so they cancel out at the threshold.
+  /// How big the lead has to be depends on how noisy the known parts are.
+  /// @param high Number of high reads so far
+  /// @param total Number of reads so far
+  bool vote_decided(int high, int total) const {
+    if (this->requiredLead == 0) return false;
+    // a high read counts 100 - percent, and a low one percent, so a sample
+    // of a 50/50 vote is 50 and we compare in hundredths of a sample
+    int32_t lead = (int32_t)high * (100 - this->percent) - (int32_t)(total - high) * this->percent;
+    return abs(lead) * 2 >= (int32_t)this->requiredLead;
+  }
+};
+
+/// @brief Picks the narrowest unsigned type holding values up to MAX, so the
+/// counts cost a single byte where they can
+template <bool FITS_BYTE, bool FITS_WORD>
+struct MSFCountTypeOf {
+  typedef uint32_t type;
+};
+
+template <bool FITS_WORD>
+struct MSFCountTypeOf<true, FITS_WORD> {
+  typedef uint8_t type;
+};
+
+template <>
+struct MSFCountTypeOf<false, true> {
+  typedef uint16_t type;
+};
+
+template <uint32_t MAX>
+struct MSFCountType : MSFCountTypeOf<MAX <= 0xFF, MAX <= 0xFFFF> {};
+
+/// @brief Votes of a Bit A/B window, counted in the narrowest type that holds
+/// the most reads the window can take. The threshold comparisons multiply the
+/// counts up instead of dividing them down to percentages, on AVR that is a
+/// few cycles instead of hundreds.
+/// @tparam MAX_SAMPLES Most reads the window can take, all the receiver
+/// modules together
+template <uint16_t MAX_SAMPLES>
+class MSFBitVote {
+  typedef typename MSFCountType<MAX_SAMPLES>::type Count;
+  // counts times 100, which is what the percentages are compared with
+  typedef typename MSFCountType<MAX_SAMPLES * 100UL>::type Scaled;
+
+  Count high = 0;
+  Count total = 0;
+
+ public:
+  void reset() { this->high = this->total = 0; }
+
+  /// @brief Adds the reads of one sample
+  /// @param samples Number of reads, one per trusted receiver module
+  /// @param highSamples How many of them read silence (binary 1)
+  void add(uint8_t samples, uint8_t highSamples) {
+    this->total += samples;
+    this->high += highSamples;
+  }
+
+  /// @brief Returns the number of high (silence) reads
+  Count get_high() const { return this->high; }
+
+  /// @brief Returns the number of reads
+  Count get_total() const { return this->total; }
+
+  /// @brief Checks if the share of high reads, rounded down to whole
+  /// percents, is over given percentage. There is nothing over anything
+  /// without reads.
+  bool is_over(uint8_t percent) const {
+    return this->total > 0 && (Scaled)this->high * 100 >= (Scaled)(percent + 1) * this->total;
+  }
+
+  /// @brief Checks if the share of high reads is between 10% and 90%, which
+  /// means the window was noisy whichever way it went
+  bool is_mixed() const {
+    Scaled scaledHigh = (Scaled)this->high * 100;
+    return scaledHigh >= (Scaled)11 * this->total && scaledHigh < (Scaled)90 * this->total;
+  }
+
+  /// @brief Returns the share of high reads in percent, 0 without reads
+  uint8_t get_percent() const {
+    return this->total > 0 ? (Scaled)this->high * 100 / this->total : 0;
+  }
+
+  /// @brief Returns the confidence stored in MSFSoftFrame, the threshold maps
+  /// to 0 and both sides of it are stretched to the full -100 to 100. This
+  /// is the one division of the window, done once a second.
+  /// @param percent Percentage above which the bit is 1, see
+  /// MSFBitThreshold
+  int8_t get_confidence(uint8_t percent) const {
+    if (this->total == 0) return 0;
+    // how far the share is from the threshold, as a fraction of the side of
+    // the threshold it is on
+    int32_t lead = (int32_t)this->high * 100 - (int32_t)percent * this->total;
+    int32_t side = (int32_t)this->total * (lead > 0 ? 100 - percent : percent);
+    return lead * 100 / side;
+  }
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+
+/// @brief Software clock disciplined by MSF fixes. Between the fixes it runs on
+/// millis(), corrected by the drift of the local oscillator it measures
+/// across successive fixes, so you can resync far less often than cheap
+/// resonators would otherwise need.
+///
+/// Feed it every decoded MSFData with update(), the time is taken at the exact
+/// minute edge the data describes (see MSFData::minuteEdgeMicros) so it does
+/// not matter how long after the edge you call it. The time is whatever MSF
+/// transmits, that is UK civil time (GMT or BST).
+///
+/// Everything is counted in millis() differences, you have to update the
+/// clock at least every 24 days.
+class MSFClock {
+  static const uint32_t SECONDS_PER_DAY = 86400UL;
+  // we never take the drift beyond this, no resonator is that bad and it
+  // keeps the fixed point math below from overflowing
+  static const int32_t MAX_DRIFT_PPB = 10000000L;
+  // the drift is averaged over this much time worth of fixes, so a single
+  // noisy minute edge does not throw it off but it still follows the
+  // oscillator as temperature changes
+  static const uint32_t DRIFT_AVERAGING_SECONDS = SECONDS_PER_DAY;
+  // how far off a minute edge can be on top of the drift, anything further
+  // is a wrong fix that passed the checksum and not our clock
+  static const int32_t MAX_EDGE_ERROR_MS = 100;
+
+  bool synced = false;
+  uint32_t fixUnixTime = 0;
+  uint32_t fixMillis = 0;
+  bool fixSummerTime = false;
+  // how much faster the local clock runs than the real time, in parts per
+  // billion, and how many seconds of fixes it is averaged over
+  int32_t driftPpb = 0;
+  uint32_t driftWeight = 0;
+  int32_t lastCorrectionMs = 0;
+
+  /// @brief Converts milliseconds on the local clock to real milliseconds
+  int32_t localToReal(int32_t localMs) const {
+    return localMs - (int32_t)((int64_t)localMs * this->driftPpb / 1000000000LL);
+  }
+
+  /// @brief Returns real milliseconds since the last fix, negative if the
+  /// minute edge of the last fix is still ahead of us
+  int32_t realSinceFix() const { return this->localToReal(millis() - this->fixMillis); }
+
+  /// @brief Checks the correction is more than a clock drifting by
+  /// MAX_DRIFT_PPB and the minute edge error can explain
+  /// @param correctionMs How far off the prediction the fix is
+  /// @param elapsedMs Real time since the previous fix
+  static bool isImplausible(int32_t correctionMs, int32_t elapsedMs) {
+    int64_t limit = (int64_t)elapsedMs * MAX_DRIFT_PPB / 1000000000LL + MAX_EDGE_ERROR_MS;
+    return correctionMs > limit || correctionMs < -limit;
+  }
+
+ public:
+  /// @brief Converts the time in MSFData to seconds since 1970-01-01 00:00,
+  /// as TimeLib and most RTC libraries use
+  /// @param data Time to convert
+  /// @return Seconds since 1970-01-01 00:00
+  static uint32_t to_unix_time(const MSFData& data) {
+    // days since 1970-01-01 of the given civil date, counting years from
+    // March so the leap day is the last day of the year
+    int32_t year = data.year - (data.month <= 2 ? 1 : 0);
+    int32_t era = year / 400;
+    int32_t yearOfEra = year - era * 400;
+    int32_t month = data.month > 2 ? data.month - 3 : data.month + 9;
+    int32_t dayOfYear = (153 * month + 2) / 5 + data.day - 1;
+    int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int32_t days = era * 146097L + dayOfEra - 719468L;
+    return days * SECONDS_PER_DAY + data.hour * 3600UL + data.minute * 60UL;
+  }
+
+  /// @brief Disciplines the clock with a new fix, the time is set to the fix
+  /// and the drift of the local clock is learned from how far off the
+  /// previous fix the clock got. Intervals across a summer time change, and
+  /// fixes further off than any drift could take us (a wrong minute that
+  /// passed the checksum), set the time but teach us nothing about the drift.
+  /// @param data Decoded time, ignored if its checksum did not pass. Its
+  /// minute edge is in micros(), so call this within half an hour of the fix.
+  /// @return True if the clock was updated
+  bool update(const MSFData& data) {
+    if (!data.checksumPassed) return false;
+
+    // the minute edge can be behind us or still ahead, the result is ready
+    // before the minute it describes starts
+    uint32_t edgeMillis = millis() + (int32_t)(data.minuteEdgeMicros - micros()) / 1000;
+    uint32_t unixTime = to_unix_time(data);
+
+    // civil time jumps by an hour when summer time starts or ends, the real
+    // time in between does not. MSF and DCF77 move their time with it,
+    // WWVB stays on UTC, so across a change we take whichever of the two
+    // the local clock agrees with.
+    int32_t elapsed = unixTime - this->fixUnixTime;
+    bool summerTimeChanged = this->synced && data.summerTime != this->fixSummerTime;
+    int32_t predicted = this->localToReal(edgeMillis - this->fixMillis);
+    if (summerTimeChanged) {
+      int32_t continuous = elapsed + (data.summerTime ? -3600L : 3600L);
+      int32_t civilError = elapsed * 1000L - predicted;
+      int32_t continuousError = continuous * 1000L - predicted;
+      if ((continuousError < 0 ? -continuousError : continuousError) <
+          (civilError < 0 ? -civilError : civilError))
+        elapsed = continuous;
+    }
+
+    int32_t realElapsed = elapsed * 1000L;
+    if (this->synced && elapsed > 0) this->lastCorrectionMs = realElapsed - predicted;
+    if (this->synced && elapsed > 0 && !summerTimeChanged &&
+        !isImplausible(this->lastCorrectionMs, realElapsed)) {
+      // measured drift over the last interval, averaged with what we know
+      // weighted by the time each of them covers
+      int32_t localElapsed = edgeMillis - this->fixMillis;
+      int64_t measuredPpb = (int64_t)(localElapsed - realElapsed) * 1000000000LL / realElapsed;
+      uint32_t interval = elapsed;
+      if (this->driftWeight + interval > DRIFT_AVERAGING_SECONDS)
+        this->driftWeight =
+            DRIFT_AVERAGING_SECONDS > interval ? DRIFT_AVERAGING_SECONDS - interval : 0;
+      int64_t drift = ((int64_t)this->driftPpb * this->driftWeight + measuredPpb * interval) /
+                      (this->driftWeight + interval);
+      if (drift > MAX_DRIFT_PPB) drift = MAX_DRIFT_PPB;
+      if (drift < -MAX_DRIFT_PPB) drift = -MAX_DRIFT_PPB;
+      this->driftPpb = drift;
+      this->driftWeight += interval;
+    }
+
+    this->fixUnixTime = unixTime;
+    this->fixMillis = edgeMillis;
+    this->fixSummerTime = data.summerTime;
+    this->synced = true;
+    return true;
+  }
+
+  /// @brief Checks if the clock got at least one fix
+  bool is_synced() const { return this->synced; }
+
+  /// @brief Returns current time in seconds since 1970-01-01 00:00, 0 if the
+  /// clock was never synced, so it can be used as TimeLib sync provider
+  uint32_t now() const {
+    uint16_t milliseconds;
+    return this->now(milliseconds);
+  }
+
+  /// @brief Returns current time in seconds since 1970-01-01 00:00, 0 if the
+  /// clock was never synced
+  /// @param milliseconds Output, milliseconds of the current second
+  uint32_t now(uint16_t& milliseconds) const {
+    milliseconds = 0;
+    if (!this->synced) return 0;
+    int32_t sinceFix = this->realSinceFix();
+    // round towards minus infinity, we can be a bit before the fix
+    int32_t seconds = sinceFix >= 0 ? sinceFix / 1000 : -((999 - sinceFix) / 1000);
+    milliseconds = sinceFix - seconds * 1000;
+    return this->fixUnixTime + seconds;
+  }
+
+  /// @brief Returns the drift of the local clock learned so far, in parts per
+  /// billion, positive if it runs fast
+  int32_t get_drift_ppb() const { return this->driftPpb; }
+
+  /// @brief Returns how far off the clock was when the last fix came in, in
+  /// milliseconds, positive if it was behind. Use it to decide how often you
+  /// need to resync.
+  int32_t get_last_correction_ms() const { return this->lastCorrectionMs; }
+};
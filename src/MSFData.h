@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// @brief How good the signal was while acquiring a result, so the caller
+/// can tell a solid minute from one that barely made it and retry or back off
+/// accordingly
+struct MSFSignalQuality {
+  // bits of failedParityGroups
+  static const uint8_t YEAR_PARITY = 1;
+  static const uint8_t DATE_PARITY = 2;
+  static const uint8_t DAY_OF_THE_WEEK_PARITY = 4;
+  static const uint8_t TIME_PARITY = 8;
+
+  // score of the minute marker we aligned to (or checked in tracking mode),
+  // in percent of a perfect one
+  uint8_t markerConfidence = 0;
+  // acquired seconds with 10% to 90% of the Bit A samples high
+  uint8_t noisySeconds = 0;
+  // how far the Bit A/B votes were from the threshold, 0 for a coin toss and
+  // 100 for all samples on one side, averaged over the acquired bits
+  uint8_t meanBitMargin = 0;
+  // parity groups that failed in the minute as it was received, the result
+  // can still pass after correction or combining minutes
+  uint8_t failedParityGroups = 0;
+  // time spent in each phase since the previous result, in milliseconds
+  uint32_t sleepMs = 0;
+  uint32_t syncMs = 0;
+  uint32_t alignMs = 0;
+  uint32_t verifyMs = 0;
+  uint32_t acquireMs = 0;
+};
+
+struct MSFData {
+  uint32_t year = 2000;  // MSF time spec gives year in 00 to 99 range, whoever maintains this in
+                         // 2100 can change it :P
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t minute;
+  static constexpr uint8_t second = 0;  // MSF signal does not transmit seconds, we know its 0
+                                        // because of how we are syncing to the minute marker
+                                        // transition
+  uint8_t dayOfTheWeek;
+  bool checksumPassed;
+  // UT1 - UTC in tenths of a second, from -8 to 8. It is only valid if we
+  // received seconds 1 to 16 and they make a valid unary code, there is no
+  // parity covering it.
+  int8_t dut1 = 0;
+  bool dut1Valid = false;
+  // summer time is in effect, for MSF that is British summer time and the
+  // time above is GMT + 1 hour, for DCF77 CEST and for WWVB US daylight saving
+  // time (the time above stays UTC)
+  bool summerTime = false;
+  // summer time starts or ends at the end of the next hour
+  bool summerTimeWarning = false;
+  // micros() timestamp of the minute edge at which the time above is exact.
+  // MSF transmits the time of the minute that starts at the next minute
+  // marker, so this is the end of the minute we decoded. The protocols that
+  // transmit the time of their own minute are moved a minute forward to match.
+  uint32_t minuteEdgeMicros = 0;
+  // standard error of minuteEdgeMicros in microseconds, from how well the
+  // second edges of the minute fit a line through them. 0xFFFF if there were
+  // too few of them and the edge is only as good as the last one we measured.
+  uint16_t minuteEdgeErrorMicros = 0xFFFF;
+  // how the signal was while acquiring this result
+  MSFSignalQuality quality;
+
+  /// @brief Returns number of days in given month (1-12) of given year
+  static uint8_t days_in_month(uint32_t year, uint8_t month) {
+    static const uint8_t DAYS[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12) return 31;
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) return 29;
+    return DAYS[month - 1];
+  }
+
+  /// @brief Returns day of the week (1 is Sunday as in MSF) of given date
+  static uint8_t day_of_the_week(uint32_t year, uint8_t month, uint8_t day) {
+    // Sakamoto's method, the offsets are the days the months start after
+    // Sunday and January and February count as months of the previous year
+    static const uint8_t OFFSETS[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    if (month < 3) year--;
+    return (year + year / 4 - year / 100 + year / 400 + OFFSETS[month - 1] + day) % 7 + 1;
+  }
+
+  /// @brief Returns day of the year of the date, 1 for 1st January
+  uint16_t day_of_year() const {
+    uint16_t days = this->day;
+    for (uint8_t month = 1; month < this->month; month++)
+      days += days_in_month(this->year, month);
+    return days;
+  }
+
+  /// @brief Sets month, day and day of the week from day of the year, the
+  /// year has to be set already
+  /// @param dayOfYear Day of the year, 1 for 1st January
+  /// @return False if there is no such day in the year, nothing is changed
+  bool set_day_of_year(uint16_t dayOfYear) {
+    if (dayOfYear < 1) return false;
+    uint8_t month = 1;
+    while (month <= 12 && dayOfYear > days_in_month(this->year, month))
+      dayOfYear -= days_in_month(this->year, month++);
+    if (month > 12) return false;
+    this->month = month;
+    this->day = dayOfYear;
+    this->dayOfTheWeek = day_of_the_week(this->year, this->month, this->day);
+    return true;
+  }
+
+  /// @brief Moves the time given number of minutes forward, carrying over to
+  /// the hours, days, months and years
+  /// @param minutes Number of minutes to add, up to cca 8000 years
+  void add_minutes(uint32_t minutes) {
+    uint32_t minuteOfDay = this->hour * 60UL + this->minute + minutes % 1440UL;
+    uint32_t days = minutes / 1440UL + minuteOfDay / 1440UL;
+    minuteOfDay %= 1440UL;
+    this->hour = minuteOfDay / 60;
+    this->minute = minuteOfDay % 60;
+    this->dayOfTheWeek = (this->dayOfTheWeek + 6 + days % 7) % 7 + 1;
+
+    while (days > 0) {
+      uint8_t daysLeftInMonth = days_in_month(this->year, this->month) - this->day;
+      if (days <= daysLeftInMonth) {
+        this->day += days;
+        break;
+      }
+      days -= daysLeftInMonth + 1;
+      this->day = 1;
+      if (++this->month > 12) {
+        this->month = 1;
+        this->year++;
+      }
+    }
+  }
+};
+
+/// @brief Outcome of the minute check, see MSFReceiver::start_minute_check()
+enum class MSFCheckResult : uint8_t {
+  NONE,       // no check finished yet, there was no lock to check or summer time change is due
+  CONFIRMED,  // the minute bits are exactly what we predicted
+  MISMATCH,   // the minute bits are not what we predicted, time has to be acquired again
+  NO_MARKER   // minute marker was not where we expected it
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// @brief Position of a sample in a minute marker rolling buffer, the byte
+/// and the bit within it
+struct MSFBufferPosition {
+  uint16_t byteIdx;
+  uint8_t mask;
+};
+
+/// @brief Combines several receiver modules into one carrier state, so an
+/// antenna sitting in an orientation null does not cost the whole minute.
+///
+/// Every input keeps its own minute marker rolling buffer next to the one of
+/// the receiver, sharing its cursors so they all update in the same pass, and
+/// the best score each of them reaches is how much we trust it. A module
+/// without signal reads noise and can not score much over half of the perfect
+/// score, a clean one gets close to all of it. Every read is then a weighted
+/// vote of the inputs, weighted by the log likelihood ratio of their reads
+/// being right, which is what maximum ratio combining does with binary
+/// decisions.
+///
+/// Two inputs can only tie or agree, so the vote alone gains nothing from a
+/// second module as good as the first one. The Bit A/B windows therefore
+/// count the reads of every trusted input (weight at least half of the best
+/// one) as samples of their own, which doubles the samples of the vote.
+///
+/// The weights are learned continuously while scanning for the minute marker
+/// and once per minute in tracking mode, so an input that fades is dropped
+/// from the vote within a minute.
+/// @tparam INPUTS Maximum number of inputs, 2 to 8, see the reader policy
+/// of the receiver
+/// @tparam LEAD_SAMPLES Samples of the silence window before the carrier one,
+/// 0 for MSF, see MSFProtocol.h
+/// @tparam CARRIER_SAMPLES Samples of the carrier window of the rolling buffer
+/// @tparam SILENCE_SAMPLES Samples of the silence window of the rolling buffer
+/// @tparam TRAIL_SAMPLES Samples of the carrier window after the silence one
+/// @tparam DECIMATION Carrier reads integrated into one rolling buffer sample
+template <uint8_t INPUTS, int LEAD_SAMPLES, int CARRIER_SAMPLES, int SILENCE_SAMPLES,
+          int TRAIL_SAMPLES, int DECIMATION>
+class MSFDiversity {
+  static_assert(INPUTS >= 2 && INPUTS <= 8, "MSFDiversity combines 2 to 8 inputs");
+
+  static const int TOTAL_SAMPLES = LEAD_SAMPLES + CARRIER_SAMPLES + SILENCE_SAMPLES + TRAIL_SAMPLES;
+  static const int BUFFER_BYTES = (TOTAL_SAMPLES + 7) / 8;
+
+  uint8_t count = 0;
+  // carrier state of every input at the last read, bit per input
+  uint8_t lastReads = 0;
+
+  uint8_t buffers[INPUTS][BUFFER_BYTES];
+  int16_t carrierScores[INPUTS];
+  int16_t silenceScores[INPUTS];
+  int16_t bestScores[INPUTS];
+  uint8_t decimatedCarrierReads[INPUTS];
+  uint8_t weights[INPUTS];
+  // wins the vote when the weights tie, which they do with two equally good
+  // inputs disagreeing
+  uint8_t strongest = 0;
+  // inputs counted in the Bit A/B votes, bit per input
+  uint8_t trusted = 0;
+  // the buffers start full of carrier, which scores well over half on any
+  // input, so we only take the scores once real samples filled them
+  uint16_t pushedSamples = 0;
+
+  /// @brief Returns weight of an input from its best score, the log
+  /// likelihood ratio ln((1 - p) / p) times 8 for p of 50%, 45% ... 5% of its
+  /// reads wrong, and 2.5% for a perfect score as we dont trust any input
+  /// completely.
+  static uint8_t weightForScore(int16_t score) {
+    static const uint8_t WEIGHTS[] = {0, 2, 3, 5, 7, 9, 11, 14, 18, 24, 29};
+    int32_t percent = (int32_t)score * 100 / TOTAL_SAMPLES;
+    if (percent <= 50) return 0;
+    return WEIGHTS[(percent - 50) / 5];
+  }
+
+ public:
+  /// @brief Sets how many inputs there are, the ones past INPUTS are ignored
+  void set_inputs(uint8_t inputCount) {
+    this->count = inputCount < INPUTS ? inputCount : INPUTS;
+    for (uint8_t i = 0; i < INPUTS; i++) this->weights[i] = 1;
+    this->strongest = 0;
+    this->trusted = (1 << this->count) - 1;
+  }
+
+  /// @brief Checks the receiver reads the carrier through us
+  bool is_active() const { return this->count > 1; }
+
+  /// @brief Fills all the rolling buffers with carrier before a new scan, the
+  /// same way the receiver does it with its own. The weights stay.
+  void reset() {
+    memset(this->buffers, 0xFF, sizeof(this->buffers));
+    for (uint8_t i = 0; i < INPUTS; i++) {
+      this->carrierScores[i] = CARRIER_SAMPLES + TRAIL_SAMPLES;
+      this->silenceScores[i] = 0;
+      this->bestScores[i] = 0;
+      this->decimatedCarrierReads[i] = 0;
+    }
+    this->pushedSamples = 0;
+  }
+
+  /// @brief Returns the weighted vote of the inputs
+  /// @param reads Carrier state of every input, bit per input, as the reader
+  /// policy of the receiver returns it
+  bool vote(uint8_t reads) {
+    int16_t vote = 0;
+    for (uint8_t i = 0; i < this->count; i++) {
+      vote += (reads & (1 << i)) ? this->weights[i] : -this->weights[i];
+    }
+    this->lastReads = reads;
+    if (vote == 0) return reads & (1 << this->strongest);
+    return vote > 0;
+  }
+
+  /// @brief Integrates the last read of every input into the current rolling
+  /// buffer sample, see MSFReceiver::decimateSample()
+  void add_read() {
+    for (uint8_t i = 0; i < this->count; i++) {
+      if (this->lastReads & (1 << i)) this->decimatedCarrierReads[i]++;
+    }
+  }
+
+  /// @brief Pushes the decimated sample of every input into its rolling
+  /// buffer, at the position of the cursors of the receiver before they move
+  /// on, see MSFReceiver::updateRollingBuffer()
+  /// @param head Oldest sample, the one leaving the buffer
+  /// @param carrierEdge Sample leaving the carrier window for the lead
+  /// silence, unused without one
+  /// @param silenceEdge Sample leaving the silence window
+  /// @param trailEdge Sample leaving the trailing carrier window, unused
+  /// without one
+  /// @param learn Update the weights straight away if an input scored better
+  void push(const MSFBufferPosition& head, const MSFBufferPosition& carrierEdge,
+            const MSFBufferPosition& silenceEdge, const MSFBufferPosition& trailEdge,
+            bool learn) {
+    bool filled = this->pushedSamples >= TOTAL_SAMPLES;
+    if (!filled) this->pushedSamples++;
+    bool improved = false;
+    for (uint8_t i = 0; i < this->count; i++) {
+      uint8_t* buffer = this->buffers[i];
+      bool carrier = this->decimatedCarrierReads[i] * 2 > DECIMATION;
+      this->decimatedCarrierReads[i] = 0;
+      bool sampleLeavingSilence = buffer[silenceEdge.byteIdx] & silenceEdge.mask;
+      bool sampleLeavingBuffer = buffer[head.byteIdx] & head.mask;
+
+      // same as the receiver does for its own buffer
+      if (sampleLeavingSilence) this->carrierScores[i]++;
+      if (!sampleLeavingSilence) this->silenceScores[i]--;
+      if (LEAD_SAMPLES > 0) {
+        bool sampleLeavingCarrier = buffer[carrierEdge.byteIdx] & carrierEdge.mask;
+        if (sampleLeavingCarrier) this->carrierScores[i]--;
+        if (!sampleLeavingCarrier) this->silenceScores[i]++;
+        if (!sampleLeavingBuffer) this->silenceScores[i]--;
+      } else if (sampleLeavingBuffer) {
+        this->carrierScores[i]--;
+      }
+      if (TRAIL_SAMPLES > 0) {
+        bool sampleLeavingTrail = buffer[trailEdge.byteIdx] & trailEdge.mask;
+        if (sampleLeavingTrail) this->carrierScores[i]--;
+        if (!sampleLeavingTrail) this->silenceScores[i]++;
+        if (carrier) this->carrierScores[i]++;
+      } else if (!carrier) {
+        this->silenceScores[i]++;
+      }
+      if (carrier)
+        buffer[head.byteIdx] |= head.mask;
+      else
+        buffer[head.byteIdx] &= ~head.mask;
+
+      int16_t score = this->carrierScores[i] + this->silenceScores[i];
+      if (filled && score > this->bestScores[i]) {
+        this->bestScores[i] = score;
+        improved = true;
+      }
+    }
+    if (learn && improved) this->update_weights();
+  }
+
+  /// @brief Sets the weights of the inputs from the best scores since the
+  /// last reset(), nothing changes until the buffers were filled
+  void update_weights() {
+    if (this->pushedSamples < TOTAL_SAMPLES) return;
+    this->strongest = 0;
+    for (uint8_t i = 0; i < this->count; i++) {
+      this->weights[i] = weightForScore(this->bestScores[i]);
+      if (this->weights[i] > this->weights[this->strongest]) this->strongest = i;
+    }
+    this->trusted = 0;
+    for (uint8_t i = 0; i < this->count; i++) {
+      if (this->weights[i] > 0 && this->weights[i] * 2 >= this->weights[this->strongest])
+        this->trusted |= 1 << i;
+    }
+    // no input is any good, the vote is as good as any of them
+    if (this->trusted == 0) this->trusted = 1 << this->strongest;
+  }
+
+  /// @brief Returns the last read of the trusted inputs as samples of a Bit
+  /// A/B window
+  /// @param samples Output, number of trusted inputs
+  /// @param highSamples Output, how many of them read silence (binary 1)
+  void last_samples(uint8_t& samples, uint8_t& highSamples) const {
+    samples = 0;
+    highSamples = 0;
+    for (uint8_t i = 0; i < this->count; i++) {
+      if (!(this->trusted & (1 << i))) continue;
+      samples++;
+      if (!(this->lastReads & (1 << i))) highSamples++;
+    }
+  }
+
+  /// @brief Returns weight of given input in the vote, 0 for an input we
+  /// ignore and 29 for a perfect one
+  uint8_t get_weight(uint8_t input) const { return input < this->count ? this->weights[input] : 0; }
+};
+
+/// @brief Single input, nothing to combine and nothing to keep
+template <int LEAD_SAMPLES, int CARRIER_SAMPLES, int SILENCE_SAMPLES, int TRAIL_SAMPLES,
+          int DECIMATION>
+class MSFDiversity<1, LEAD_SAMPLES, CARRIER_SAMPLES, SILENCE_SAMPLES, TRAIL_SAMPLES, DECIMATION> {
+ public:
+  void set_inputs(uint8_t) {}
+  bool is_active() const { return false; }
+  void reset() {}
+  bool vote(uint8_t reads) { return reads; }
+  void add_read() {}
+  void push(const MSFBufferPosition&, const MSFBufferPosition&, const MSFBufferPosition&,
+            const MSFBufferPosition&, bool) {}
+  void update_weights() {}
+  void last_samples(uint8_t&, uint8_t&) const {}
+  uint8_t get_weight(uint8_t) const { return 0; }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Number of carrier transitions the edge buffer can hold before tick() has to
+// drain it. Clean MSF signal gives us 2 to 4 edges per second, noisy receivers
+// can give a lot more, so increase this if you call tick() rarely. Must be a
+// power of two and at most 128.
+#ifndef MSF_TIME_LIB_EDGE_BUFFER_SIZE
+#define MSF_TIME_LIB_EDGE_BUFFER_SIZE 32
+#endif
+
+/// @brief Small lock-free single producer single consumer ring buffer holding
+/// micros() timestamps of carrier transitions. The producer is a pin change
+/// interrupt calling push(), the consumer is MSFReceiver::tick() which drains
+/// it, so the MCU does not have to poll the input pin at all.
+class MSFEdgeBuffer {
+  static const uint8_t SIZE = MSF_TIME_LIB_EDGE_BUFFER_SIZE;
+  static const uint8_t MASK = SIZE - 1;
+  static_assert(SIZE >= 2 && SIZE <= 128 && (SIZE & MASK) == 0,
+                "MSF_TIME_LIB_EDGE_BUFFER_SIZE must be a power of two between 2 and 128");
+
+  // we dont have spare bit anywhere else, so the carrier state after the
+  // transition is stored in the lowest bit of the timestamp, loosing 1us of
+  // resolution which is way below what micros() gives us on most platforms
+  volatile uint32_t edges[SIZE];
+
+  // head is only written by the producer and tail only by the consumer, both
+  // are single byte so reads and writes are atomic even on 8 bit AVR
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+  volatile bool overflowed = false;
+
+ public:
+  /// @brief Pushes a carrier transition into the buffer. Meant to be called
+  /// from the pin change interrupt of the receiver module input pin.
+  /// @param timestampMicros micros() timestamp of the transition
+  /// @param carrier New state of the carrier after the transition (true for
+  /// carrier, false for silence)
+  /// @return False if the buffer is full and the edge was dropped
+  bool push(uint32_t timestampMicros, bool carrier) {
+    uint8_t currentHead = this->head;
+    uint8_t nextHead = (currentHead + 1) & MASK;
+    if (nextHead == this->tail) {
+      this->overflowed = true;
+      return false;
+    }
+    this->edges[currentHead] = (timestampMicros & ~1UL) | (carrier ? 1UL : 0UL);
+    // only publish the new head once the edge is written
+    this->head = nextHead;
+    return true;
+  }
+
+  /// @brief Reads the oldest edge without removing it from the buffer
+  /// @param timestampMicros output, micros() timestamp of the transition
+  /// @param carrier output, state of the carrier after the transition
+  /// @return False if the buffer is empty
+  bool peek(uint32_t& timestampMicros, bool& carrier) const {
+    uint8_t currentTail = this->tail;
+    if (currentTail == this->head) return false;
+    uint32_t edge = this->edges[currentTail];
+    timestampMicros = edge & ~1UL;
+    carrier = edge & 1UL;
+    return true;
+  }
+
+  /// @brief Removes the oldest edge from the buffer, call after peek()
+  void pop() {
+    uint8_t currentTail = this->tail;
+    if (currentTail == this->head) return;
+    this->tail = (currentTail + 1) & MASK;
+  }
+
+  /// @brief Checks if any edge was dropped because the buffer was full, and
+  /// clears the flag
+  /// @return True if edges were dropped since last call
+  bool check_and_clear_overflow() {
+    bool result = this->overflowed;
+    this->overflowed = false;
+    return result;
+  }
+};
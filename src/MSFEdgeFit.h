@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// @brief Least squares fit of a straight line through the second edges of a
+/// minute, to find its minute edge much more precisely than any single second
+/// edge can. Every edge is measured to a sample at best, or to the
+/// microsecond in edge capture mode, and jitters with noise. The line through
+/// cca 59 of them averages that out, and its slope is how fast our clock runs
+/// against the transmitter, so the minute edge at its end is not thrown off by
+/// drift either.
+///
+/// The edges are given as offsets from a grid of exact seconds from the
+/// start of the minute, so even a clock off by 0.75% keeps them within 0.5s.
+/// The fit is done in 64 bit integers once per minute, there is no floating
+/// point.
+class MSFEdgeFit {
+  // the seconds are counted from the middle of the minute, which keeps the
+  // sums small and the fit well conditioned
+  static const int8_t CENTER = 30;
+
+  uint8_t count = 0;
+  int16_t sumX = 0;
+  int32_t sumXX = 0;
+  int32_t sumY = 0;
+  int64_t sumXY = 0;
+  int64_t sumYY = 0;
+
+  /// @brief Divides rounding to the nearest, the divisor has to be positive
+  static int64_t divideRounded(int64_t dividend, int64_t divisor) {
+    return (dividend >= 0 ? dividend + divisor / 2 : dividend - divisor / 2) / divisor;
+  }
+
+  /// @brief Returns the integer square root, rounded down
+  static uint32_t squareRoot(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+      if (value >= root + bit) {
+        value -= root + bit;
+        root = (root >> 1) + bit;
+      } else {
+        root >>= 1;
+      }
+      bit >>= 2;
+    }
+    return root;
+  }
+
+ public:
+  // fewer edges than this and we dont trust the line, with two it would even
+  // fit perfectly
+  static const uint8_t MIN_EDGES = 8;
+  // returned as the error of an estimate we could not make
+  static const uint16_t UNKNOWN_ERROR_US = 0xFFFF;
+
+  /// @brief Drops all the edges before a new minute
+  void reset() {
+    this->count = 0;
+    this->sumX = 0;
+    this->sumXX = 0;
+    this->sumY = 0;
+    this->sumXY = 0;
+    this->sumYY = 0;
+  }
+
+  /// @brief Adds the measured edge of one second
+  /// @param second Second of the minute (0-59)
+  /// @param offsetUs Where the edge was measured, in microseconds from the
+  /// start of the minute plus that many whole seconds
+  void add(int second, int32_t offsetUs) {
+    int8_t x = second - CENTER;
+    this->count++;
+    this->sumX += x;
+    this->sumXX += x * x;
+    this->sumY += offsetUs;
+    this->sumXY += (int32_t)x * offsetUs;
+    this->sumYY += (int64_t)offsetUs * offsetUs;
+  }
+
+  /// @brief Returns how many edges were added since the last reset()
+  uint8_t get_count() const { return this->count; }
+
+  /// @brief Returns where the line puts the edge of given second
+  /// @param second Second to estimate the edge of, 60 for the edge at the end
+  /// of the minute
+  /// @param offsetUs Output, the edge in microseconds from the start of the
+  /// minute plus that many whole seconds
+  /// @param errorUs Output, standard error of the estimate in microseconds,
+  /// UNKNOWN_ERROR_US if it is larger than that
+  /// @return False if there are too few edges to fit
+  bool estimate(int second, int32_t& offsetUs, uint16_t& errorUs) const {
+    errorUs = UNKNOWN_ERROR_US;
+    if (this->count < MIN_EDGES) return false;
+    int64_t n = this->count;
+    // n times the spread of the seconds and n times their covariance with
+    // the offsets, everything below is kept multiplied by n to stay integer
+    int64_t spread = n * this->sumXX - (int64_t)this->sumX * this->sumX;
+    if (spread <= 0) return false;
+    int64_t covariance = n * this->sumXY - (int64_t)this->sumX * this->sumY;
+    int64_t fromMean = n * (second - CENTER) - this->sumX;
+    offsetUs = divideRounded(this->sumY * spread + covariance * fromMean, n * spread);
+
+    // n times the sum of squared residuals, covariance squared would not fit
+    // in 64 bits so it is divided in two steps
+    int64_t quotient = covariance / spread;
+    int64_t remainder = covariance % spread;
+    int64_t residuals = n * this->sumYY - (int64_t)this->sumY * this->sumY -
+                        (quotient * covariance + remainder * covariance / spread);
+    if (residuals < 0) residuals = 0;
+    // variance of the line at given second is the variance of the residuals
+    // times 1 / n + (x - mean)^2 / spread of the seconds
+    int64_t residualVariance = residuals / (n * (n - 2));
+    int64_t variance = residualVariance * (spread + fromMean * fromMean) / (n * spread);
+    if (variance < (int64_t)UNKNOWN_ERROR_US * UNKNOWN_ERROR_US)
+      errorUs = squareRoot((uint32_t)variance);
+    return true;
+  }
+};
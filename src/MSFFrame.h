@@ -0,0 +1,203 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+#include "MSFTimeCode.h"
+
+/// @brief Hard decoded Bit A and Bit B of one minute. Each is a single 64 bit
+/// word with the 0th second in the highest used bit, so the bits of every
+/// field follow each other in the order they are transmitted and any field or
+/// parity group is just a shift and a mask away. It is cheap to copy, so
+/// candidate frames can be modified and decoded again as many times as needed
+/// without touching the original.
+struct MSFFrame {
+  uint64_t bitA;
+  uint64_t bitB;
+
+  /// @brief Sets all the bits to 0
+  void clear() {
+    this->bitA = 0;
+    this->bitB = 0;
+  }
+
+  /// @brief Returns the mask of given second in bitA and bitB
+  /// @param second Second of the minute (0-59)
+  static uint64_t secondMask(int second) { return 1ULL << (59 - second); }
+
+  /// @brief Returns Bit A of given second (0-59)
+  bool a(int second) const { return this->bitA & secondMask(second); }
+
+  /// @brief Returns Bit B of given second (0-59)
+  bool b(int second) const { return this->bitB & secondMask(second); }
+
+  /// @brief Sets Bit A of given second (0-59)
+  void set_a(int second, bool value) {
+    if (value)
+      this->bitA |= secondMask(second);
+    else
+      this->bitA &= ~secondMask(second);
+  }
+
+  /// @brief Sets Bit B of given second (0-59)
+  void set_b(int second, bool value) {
+    if (value)
+      this->bitB |= secondMask(second);
+    else
+      this->bitB &= ~secondMask(second);
+  }
+
+  /// @brief Returns given number of low bits of raw in reverse order
+  static uint8_t reverseBits(uint8_t raw, uint8_t width) {
+    uint8_t reversed = 0;
+    for (uint8_t i = 0; i < width; i++, raw >>= 1) reversed = (reversed << 1) | (raw & 1);
+    return reversed;
+  }
+
+  /// @brief Returns the raw bits of BCD field, most significant bit first no
+  /// matter the order they were sent in
+  /// @tparam FIELD Field to read, see MSFTimeCode
+  template <class FIELD>
+  uint8_t raw() const {
+    uint8_t raw = (this->bitA >> (60 - FIELD::START_BIT - FIELD::NUM_BITS)) &
+                  ((1U << FIELD::NUM_BITS) - 1);
+    if (FIELD::REVERSED) raw = reverseBits(raw, FIELD::NUM_BITS);
+    return raw;
+  }
+
+  /// @brief Decodes BCD field, the bits come out of a single shift and mask
+  /// already in the order of their weights (or reversed for the fields sent
+  /// least significant bit first)
+  /// @tparam FIELD Field to decode, see MSFTimeCode
+  /// @return Decoded integer value
+  template <class FIELD>
+  int bcd() const {
+    uint8_t raw = this->raw<FIELD>();
+    return (raw >> 4) * 10 + (raw & 0x0F);
+  }
+
+  /// @brief Encodes value into BCD field, the opposite of bcd()
+  /// @tparam FIELD Field to encode, see MSFTimeCode
+  /// @param value Value to encode, must fit the field
+  template <class FIELD>
+  void set_bcd(int value) {
+    const int shift = 60 - FIELD::START_BIT - FIELD::NUM_BITS;
+    const uint64_t fieldMask = ((1ULL << FIELD::NUM_BITS) - 1) << shift;
+    uint64_t raw = ((value / 10) << 4) | (value % 10);
+    if (FIELD::REVERSED) raw = reverseBits(raw, FIELD::NUM_BITS);
+    this->bitA = (this->bitA & ~fieldMask) | ((raw << shift) & fieldMask);
+  }
+
+  /// @brief Returns the mask of Bit A bits covered by given parity group
+  template <class GROUP>
+  static uint64_t groupMask() {
+    return ((1ULL << GROUP::NUM_BITS) - 1) << (60 - GROUP::START_BIT - GROUP::NUM_BITS);
+  }
+
+  /// @brief Checks the parity of given group, odd parity in Bit B as in MSF
+  /// spec unless the group says otherwise
+  /// @tparam GROUP Parity group to check, see MSFTimeCode
+  /// @return True if parity is correct, false otherwise
+  template <class GROUP>
+  bool parity_ok() const {
+    bool parity = GROUP::IN_B ? this->b(GROUP::PARITY_BIT_IDX) : this->a(GROUP::PARITY_BIT_IDX);
+    return (__builtin_parityll(this->bitA & groupMask<GROUP>()) != parity) == GROUP::ODD_PARITY;
+  }
+
+  /// @brief Sets the parity bit of given group so the group passes
+  /// parity_ok()
+  /// @tparam GROUP Parity group to set, see MSFTimeCode
+  template <class GROUP>
+  void set_parity() {
+    bool parity = __builtin_parityll(this->bitA & groupMask<GROUP>()) != GROUP::ODD_PARITY;
+    if (GROUP::IN_B)
+      this->set_b(GROUP::PARITY_BIT_IDX, parity);
+    else
+      this->set_a(GROUP::PARITY_BIT_IDX, parity);
+  }
+
+  /// @brief Builds the frame MSF transmits for given time, the opposite of
+  /// decode()
+  /// @param data Time to encode
+  void encode(const MSFData& data) {
+    this->clear();
+    // 0th second is 500ms of silence, so both bits are 1, and Bit A of seconds
+    // 52 to 59 is always 01111110
+    this->set_a(0, true);
+    this->set_b(0, true);
+    for (int second = 53; second <= 58; second++) this->set_a(second, true);
+
+    this->set_bcd<MSFTimeCode::Year>(data.year % 100);
+    this->set_bcd<MSFTimeCode::Month>(data.month);
+    this->set_bcd<MSFTimeCode::Day>(data.day);
+    this->set_bcd<MSFTimeCode::DayOfTheWeek>(data.dayOfTheWeek - 1);
+    this->set_bcd<MSFTimeCode::Hour>(data.hour);
+    this->set_bcd<MSFTimeCode::Minute>(data.minute);
+
+    this->set_parity<MSFTimeCode::YearParity>();
+    this->set_parity<MSFTimeCode::DateParity>();
+    this->set_parity<MSFTimeCode::DayOfTheWeekParity>();
+    this->set_parity<MSFTimeCode::TimeParity>();
+
+    int dut1Start = data.dut1 >= 0 ? MSFTimeCode::DUT1_POSITIVE_START_BIT
+                                   : MSFTimeCode::DUT1_NEGATIVE_START_BIT;
+    for (int i = 0; i < abs(data.dut1) && i < MSFTimeCode::DUT1_NUM_BITS; i++)
+      this->set_b(dut1Start + i, true);
+    this->set_b(MSFTimeCode::SUMMER_TIME_WARNING_BIT_IDX, data.summerTimeWarning);
+    this->set_b(MSFTimeCode::SUMMER_TIME_BIT_IDX, data.summerTime);
+  }
+
+  /// @brief Decodes the fields carried only in Bit B and not covered by any
+  /// parity, that is DUT1 and the summer time bits
+  /// @param data Output, only these fields are set
+  void decode_b_fields(MSFData& data) const {
+    const uint8_t fieldMask = (1U << MSFTimeCode::DUT1_NUM_BITS) - 1;
+    uint8_t positive = (this->bitB >> (60 - MSFTimeCode::DUT1_POSITIVE_START_BIT -
+                                       MSFTimeCode::DUT1_NUM_BITS)) &
+                       fieldMask;
+    uint8_t negative = (this->bitB >> (60 - MSFTimeCode::DUT1_NEGATIVE_START_BIT -
+                                       MSFTimeCode::DUT1_NUM_BITS)) &
+                       fieldMask;
+    // unary code is ones followed by zeros, so the inverted field has to be
+    // zeros followed by ones, and only one sign can be set
+    uint8_t positiveGaps = ~positive & fieldMask;
+    uint8_t negativeGaps = ~negative & fieldMask;
+    bool unary = (positiveGaps & (positiveGaps + 1)) == 0 &&
+                 (negativeGaps & (negativeGaps + 1)) == 0 && (positive == 0 || negative == 0);
+    data.dut1 = __builtin_popcount(positive) - __builtin_popcount(negative);
+    data.dut1Valid = unary;
+
+    data.summerTimeWarning = this->b(MSFTimeCode::SUMMER_TIME_WARNING_BIT_IDX);
+    data.summerTime = this->b(MSFTimeCode::SUMMER_TIME_BIT_IDX);
+  }
+
+  /// @brief Decodes the frame into MSFData
+  /// @return Struct containing decoded time and checksum result, the checksum
+  /// passes if all parity groups are correct and all values are in range
+  MSFData decode() const {
+    MSFData decoded;
+
+    int rawYear = this->bcd<MSFTimeCode::Year>();
+    decoded.year += rawYear;
+    decoded.month = this->bcd<MSFTimeCode::Month>();
+    decoded.day = this->bcd<MSFTimeCode::Day>();
+    decoded.hour = this->bcd<MSFTimeCode::Hour>();
+    decoded.minute = this->bcd<MSFTimeCode::Minute>();
+    decoded.dayOfTheWeek = this->bcd<MSFTimeCode::DayOfTheWeek>() + 1;
+
+    // each piece of information has its own parity bit as in MSF spec, see
+    // MSFTimeCode for where they are
+    bool pYear = this->parity_ok<MSFTimeCode::YearParity>();
+    bool pDate = this->parity_ok<MSFTimeCode::DateParity>();
+    bool pDOW = this->parity_ok<MSFTimeCode::DayOfTheWeekParity>();
+    bool pTime = this->parity_ok<MSFTimeCode::TimeParity>();
+
+    bool sane = (decoded.month >= 1 && decoded.month <= 12) &&
+                (decoded.day >= 1 && decoded.day <= 31) && (decoded.hour <= 23) &&
+                (decoded.minute <= 59);
+
+    decoded.checksumPassed = pYear && pDate && pDOW && pTime && sane;
+    this->decode_b_fields(decoded);
+    return decoded;
+  }
+};
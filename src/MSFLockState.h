@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+
+/// @brief Everything the receiver needs to pick up the signal again straight
+/// after a reset or deep sleep, without scanning for the minute marker. It is
+/// a plain struct of fixed size, so it can be kept in RTC memory or written to
+/// EEPROM as it is, see MSFReceiver::get_lock_state() and
+/// MSFReceiver::restore_lock_state().
+struct MSFLockState {
+  // changes whenever the layout does, so state saved by older version of the
+  // library is simply ignored
+  static const uint16_t MAGIC = 0x4D06;
+
+  uint16_t magic;
+  // how far into the minute we were when the state was saved, in microseconds
+  uint32_t minutePhase;
+  // how much longer (or shorter) a second is on the local clock, in
+  // microseconds
+  int32_t secondPeriodCorrection;
+  // time of the minute we were in when the state was saved, carried forward
+  // from the last decoded one
+  MSFData minuteTime;
+  uint16_t checksum;
+
+  /// @brief Calculates Fletcher-16 checksum of everything but the checksum
+  /// itself, 8 bit friendly and good enough to catch uninitialized or
+  /// corrupted memory
+  uint16_t calculate_checksum() const {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(this);
+    uint16_t sum1 = 0, sum2 = 0;
+    for (size_t i = 0; i < offsetof(MSFLockState, checksum); i++) {
+      sum1 = (sum1 + bytes[i]) % 255;
+      sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+  }
+
+  /// @brief Checks the state was saved by get_lock_state() and was not
+  /// corrupted since
+  bool is_valid() const {
+    return this->magic == MAGIC && this->checksum == this->calculate_checksum();
+  }
+};
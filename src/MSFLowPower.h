@@ -0,0 +1,156 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <esp_sleep.h>
+#endif
+
+// How early we wake up before the next event, to cover the wakeup latency of
+// the sleep mode. ESP32 light sleep takes cca 1ms to wake up, AVR idle mode
+// wakes up instantly.
+#ifndef MSF_TIME_LIB_SLEEP_GUARD_US
+#if defined(ARDUINO_ARCH_ESP32)
+#define MSF_TIME_LIB_SLEEP_GUARD_US 2000
+#else
+#define MSF_TIME_LIB_SLEEP_GUARD_US 0
+#endif
+#endif
+
+/// @brief Helper that drives a MSFReceiver state machine and puts the MCU to
+/// sleep between its events. The receiver knows when it needs the next sample
+/// (only Bit A and Bit B windows of every second are sampled while acquiring,
+/// and the alignment wait has a fixed deadline), so we can sleep through
+/// everything else.
+///
+/// On AVR this uses SLEEP_MODE_IDLE, which keeps timer0 running so millis()
+/// and micros() stay correct and the MCU is woken up by timer0 overflow every
+/// ~1ms to check the deadline. Deeper sleep modes stop timer0 and the watchdog
+/// is way too imprecise to align with the minute, so they are not used. On
+/// ESP32 this uses light sleep with timer wakeup, note that in edge capture
+/// mode you have to enable GPIO wakeup yourself (gpio_wakeup_enable() and
+/// esp_sleep_enable_gpio_wakeup()) otherwise edges are lost while sleeping. On
+/// all other platforms we just delay, which is no worse than get_time().
+/// @tparam RECEIVER MSFReceiver type this scheduler drives
+template <class RECEIVER>
+class MSFLowPowerScheduler {
+  RECEIVER& receiver;
+  uint32_t activeTime = 0;
+  uint32_t sleptTime = 0;
+  uint32_t lastMark;
+  bool statsStarted = false;
+
+  /// @brief Puts the MCU to sleep for given time, or less if it gets woken up
+  /// by an interrupt
+  /// @param duration Time to sleep in microseconds
+  void sleepFor(uint32_t duration) {
+#if defined(__AVR__)
+    uint32_t start = micros();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    // timer0 overflow wakes us every 1.024ms, so keep going back to sleep
+    // until there is less than one overflow period left
+    while (micros() - start + 1100 < duration) sleep_cpu();
+    sleep_disable();
+#elif defined(ARDUINO_ARCH_ESP32)
+    esp_sleep_enable_timer_wakeup(duration);
+    esp_light_sleep_start();
+#else
+    if (duration >= 1000) delay(duration / 1000);
+    else delayMicroseconds(duration);
+#endif
+  }
+
+ public:
+  /// @brief Initializes the scheduler for given receiver
+  /// @param msfReceiver Receiver to drive, it must outlive the scheduler
+  MSFLowPowerScheduler(RECEIVER& msfReceiver) : receiver(msfReceiver) {}
+
+  /// @brief Advances the receiver state machine and sleeps until its next
+  /// event. Use instead of MSFReceiver::tick() when nothing else needs the CPU
+  /// in between.
+  /// @return True when the result is ready and can be read with
+  /// MSFReceiver::get_result().
+  bool tick() {
+    uint32_t start = micros();
+    if (this->statsStarted) this->activeTime += start - this->lastMark;
+    this->statsStarted = true;
+
+    bool ready = this->receiver.tick();
+
+    uint32_t wait = this->receiver.get_time_until_next_event();
+    if (!ready && wait > MSF_TIME_LIB_SLEEP_GUARD_US) {
+      uint32_t sleepStart = micros();
+      this->activeTime += sleepStart - start;
+      this->sleepFor(wait - MSF_TIME_LIB_SLEEP_GUARD_US);
+      this->lastMark = micros();
+      this->sleptTime += this->lastMark - sleepStart;
+    } else {
+      this->lastMark = start;
+    }
+    return ready;
+  }
+
+  /// @brief Same as MSFReceiver::get_time() but sleeping between the events
+  /// @return Struct containing decoded time and checksum result.
+  MSFData get_time() {
+    this->receiver.start();
+    while (!this->tick()) {
+    }
+    return this->receiver.get_result();
+  }
+
+  /// @brief Same as MSFReceiver::get_time_with_retry() but sleeping between
+  /// the events
+  /// @return Struct containing decoded time and checksum result.
+  MSFData get_time_with_retry() {
+    this->receiver.start_tracking();
+    while (true) {
+      if (this->tick() && this->receiver.get_result().checksumPassed) {
+        this->receiver.stop();
+        return this->receiver.get_result();
+      }
+    }
+  }
+
+  /// @brief Same as MSFReceiver::check_time() but sleeping between the events,
+  /// this is where the minute check saves the most
+  /// @return Outcome of the check, see MSFCheckResult
+  MSFCheckResult check_time() {
+    if (!this->receiver.start_minute_check()) return MSFCheckResult::NONE;
+    while (!this->tick()) {
+    }
+    return this->receiver.get_check_result();
+  }
+
+  /// @brief Returns the percentage of time the MCU was awake since the last
+  /// reset_stats() call. Everything that is not spent sleeping counts as awake,
+  /// including your own code running between the tick() calls.
+  uint8_t get_duty_cycle_percent() const {
+    uint32_t total = this->activeTime + this->sleptTime;
+    if (total < 100) return 100;
+    uint32_t percent = this->activeTime / (total / 100);
+    return percent > 100 ? 100 : percent;
+  }
+
+  /// @brief Returns total time in microseconds spent awake since the last
+  /// reset_stats() call
+  uint32_t get_active_time() const { return this->activeTime; }
+
+  /// @brief Returns total time in microseconds spent sleeping since the last
+  /// reset_stats() call
+  uint32_t get_slept_time() const { return this->sleptTime; }
+
+  /// @brief Resets the duty cycle statistics, the counters are in
+  /// microseconds so they wrap after ~71 minutes, reset them at least that
+  /// often if you want meaningful numbers
+  void reset_stats() {
+    this->activeTime = 0;
+    this->sleptTime = 0;
+    this->statsStarted = false;
+  }
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFState.h"
+
+#if MSF_TIME_LIB_DEBUG
+#define MSF_TIME_LIB_LOG(...) Serial.print(__VA_ARGS__)
+#define MSF_TIME_LIB_LOGLN(...) Serial.println(__VA_ARGS__)
+#else
+#define MSF_TIME_LIB_LOG(...)
+#define MSF_TIME_LIB_LOGLN(...)
+#endif
+
+// Observer MSFReceiver reports its events to unless one is given as its
+// template parameter, see MSFNoObserver for what it gets. With
+// MSF_TIME_LIB_DEBUG the events are printed along with the rest of the log.
+#ifndef MSF_TIME_LIB_OBSERVER
+#if MSF_TIME_LIB_DEBUG
+#define MSF_TIME_LIB_OBSERVER MSFLogObserver
+#else
+#define MSF_TIME_LIB_OBSERVER MSFNoObserver
+#endif
+#endif
+
+/// @brief Minute marker the scan aligned to, reported at its end
+struct MSFSyncPeakEvent {
+  // timestamp of the minute start in microseconds, on micros() clock
+  uint32_t minuteStart;
+  // best rolling buffer score of the whole scan
+  uint16_t bestScore;
+  // score of the candidate we aligned to, it is not always the best one
+  uint16_t markerScore;
+  // score of a perfect minute marker
+  uint16_t perfectScore;
+  // see MSFSyncCandidate::rank(), 0 if there was no candidate
+  int16_t rank;
+};
+
+/// @brief One acquired second of the minute
+struct MSFSecondEvent {
+  uint8_t second;
+  bool a;
+  bool b;
+  // share of high (silence) samples in the Bit A and Bit B windows, 0-100
+  uint8_t percentA;
+  uint8_t percentB;
+  // how many samples the votes took, early stop makes these vary
+  uint16_t samplesA;
+  uint16_t samplesB;
+  // which side of them a bit is taken as 1, see MSFBitThreshold
+  uint8_t threshold;
+  // where the carrier went off against where we expected it
+  int32_t edgeErrorUs;
+};
+
+/// @brief Outcome of decoding a whole minute
+struct MSFParityEvent {
+  // parity groups of the minute as it was received, see MSFTimeCode
+  bool yearOk;
+  bool dateOk;
+  bool dayOfTheWeekOk;
+  bool timeOk;
+  // a single wrong bit was flipped to make the checksum pass
+  bool corrected;
+  // the minute failed on its own and passed once combined with this many
+  // minutes (itself included), 0 if not combined
+  uint8_t combinedMinutes;
+  bool checksumPassed;
+};
+
+/// @brief Observer that ignores everything, and the interface every observer
+/// has to implement. Observers are passed to MSFReceiver as its OBSERVER
+/// template parameter and all of their methods are static, so there is no
+/// call, no memory and no code when they do nothing. Keep the state of your
+/// observer in static members or globals, the same way as the reader
+/// function does.
+///
+/// The events come straight from the sampling loop, so anything an observer
+/// does delays the next sample. Copy the event into RAM or push it into a
+/// buffer and do the slow part (Serial, radio) after the acquisition, or
+/// while the state machine waits, see MSFReceiver::get_time_until_next_event().
+struct MSFNoObserver {
+  /// @brief Called when the state machine moves to another state, how long a
+  /// phase took is the difference of the timestamps
+  /// @param state State we just entered
+  /// @param now Timestamp in microseconds
+  static void on_state(MSFState /* state */, uint32_t /* now */) {}
+
+  /// @brief Called for every sample of the minute marker scan
+  /// @param now Timestamp of the sample in microseconds
+  /// @param score Rolling buffer score after the sample
+  /// @param bestScore Best score of the scan so far
+  static void on_sync_score(uint32_t /* now */, int /* score */, int /* bestScore */) {}
+
+  /// @brief Called at the end of the minute marker scan
+  static void on_sync_peak(const MSFSyncPeakEvent& /* peak */) {}
+
+  /// @brief Called once the bits of a second are taken
+  static void on_second(const MSFSecondEvent& /* second */) {}
+
+  /// @brief Called once a whole minute is decoded, minute checks do not
+  /// decode anything
+  static void on_parity(const MSFParityEvent& /* parity */) {}
+};
+
+/// @brief Observer printing the events through MSF_TIME_LIB_LOG, this is the
+/// sync progress and the per second table of the debug log. Without
+/// MSF_TIME_LIB_DEBUG there is nothing to print it to, so it ignores
+/// everything.
+#if MSF_TIME_LIB_DEBUG
+struct MSFLogObserver : MSFNoObserver {
+  static void on_state(MSFState state, uint32_t now) {
+    if (state == MSFState::SYNC) syncStartedAt() = lastPrint() = now;
+  }
+
+  static void on_sync_score(uint32_t now, int score, int bestScore) {
+    if (now - lastPrint() < 100000UL) return;
+    lastPrint() = now;
+    MSF_TIME_LIB_LOG(F("\r[MSF] T+"));
+    MSF_TIME_LIB_LOG((now - syncStartedAt()) / 1000000UL);
+    MSF_TIME_LIB_LOG(F("."));
+    MSF_TIME_LIB_LOG(((now - syncStartedAt()) % 1000000UL) / 100000UL);
+    MSF_TIME_LIB_LOG(F("s | Curr: "));
+    MSF_TIME_LIB_LOG(score);
+    MSF_TIME_LIB_LOG(F(" | Best: "));
+    MSF_TIME_LIB_LOG(bestScore);
+    MSF_TIME_LIB_LOG(F("         "));
+  }
+
+  static void on_sync_peak(const MSFSyncPeakEvent& peak) {
+    MSF_TIME_LIB_LOGLN();
+    MSF_TIME_LIB_LOG(F("[MSF] Final Peak Score: "));
+    MSF_TIME_LIB_LOG(peak.bestScore);
+    MSF_TIME_LIB_LOGLN();
+    MSF_TIME_LIB_LOG(F("[MSF] Best candidate score: "));
+    MSF_TIME_LIB_LOG(peak.markerScore);
+    MSF_TIME_LIB_LOG(F(", rank: "));
+    MSF_TIME_LIB_LOG(peak.rank);
+    MSF_TIME_LIB_LOGLN();
+  }
+
+  static void on_second(const MSFSecondEvent& second) {
+    MSF_TIME_LIB_LOG(F("[MSF] Sec "));
+    if (second.second < 10) MSF_TIME_LIB_LOG(F("0"));
+    MSF_TIME_LIB_LOG((int)second.second);
+    MSF_TIME_LIB_LOG(F(" | A:"));
+    MSF_TIME_LIB_LOG((second.a) ? F("1") : F("0"));
+    MSF_TIME_LIB_LOG(F(" ["));
+    MSF_TIME_LIB_LOG((int)second.percentA);
+    MSF_TIME_LIB_LOG(F("%]"));
+    MSF_TIME_LIB_LOG(F(" | B:"));
+    MSF_TIME_LIB_LOG((second.b) ? F("1") : F("0"));
+    MSF_TIME_LIB_LOG(F(" ["));
+    MSF_TIME_LIB_LOG((int)second.percentB);
+    MSF_TIME_LIB_LOG(F("%]"));
+    MSF_TIME_LIB_LOG(F(" | Edge: "));
+    MSF_TIME_LIB_LOG(second.edgeErrorUs);
+    MSF_TIME_LIB_LOG(F("us"));
+
+    if (second.percentA < 90 && second.percentA > 10) MSF_TIME_LIB_LOG(F(" <--- NOISY"));
+    MSF_TIME_LIB_LOGLN();
+  }
+
+  static void on_parity(const MSFParityEvent& parity) {
+    MSF_TIME_LIB_LOG(F("[MSF] Parity year/date/dow/time: "));
+    MSF_TIME_LIB_LOG(parity.yearOk ? F("1") : F("0"));
+    MSF_TIME_LIB_LOG(parity.dateOk ? F("1") : F("0"));
+    MSF_TIME_LIB_LOG(parity.dayOfTheWeekOk ? F("1") : F("0"));
+    MSF_TIME_LIB_LOGLN(parity.timeOk ? F("1") : F("0"));
+  }
+
+ private:
+  static uint32_t& syncStartedAt() {
+    static uint32_t at = 0;
+    return at;
+  }
+
+  static uint32_t& lastPrint() {
+    static uint32_t at = 0;
+    return at;
+  }
+};
+#else
+struct MSFLogObserver : MSFNoObserver {};
+#endif
@@ -0,0 +1,551 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+#include "MSFFrame.h"
+#include "MSFSoftAccumulator.h"
+#include "MSFTimeCode.h"
+
+// Protocol descriptors tell MSFReceiver which time signal it decodes, they are
+// passed to it as its PROTOCOL template parameter. MSF, DCF77, WWVB and JJY
+// all send a bit per second as the carrier (or its power) going off at the
+// start of the second for a time that carries the bit, and mark the minute
+// with a pattern no other second has. So the sync core is the same for all of
+// them: the rolling buffer scores the minute marker template, the second
+// edges are tracked the same way and the bits are voted in their windows.
+// What differs is described here:
+//
+//   INVERTED                   the carrier (full power) is what marks the
+//                              start of the second (JJY), the reads are
+//                              inverted before anything else sees them
+//   MARKER_LEAD_SILENCE_MS     minute marker template, oldest part first:
+//   MARKER_CARRIER_MS          silence, carrier, silence and carrier. The
+//   MARKER_SILENCE_MS          minute starts where the (second) silence
+//   MARKER_TRAIL_CARRIER_MS    starts, the outer two can be 0
+//   MINUTE_EDGE_SEARCH_BEFORE_MS  how much carrier comes before the minute
+//                              edge for sure, its search starts this early
+//   BIT_A_START_MS ...         Bit A and Bit B windows, both ends inclusive
+//   HAS_BIT_B                  there is a Bit B window at all
+//   BIT_A_INVERTED ...         the bit is 1 for carrier and not for silence
+//   KNOWN_SILENCE_START_MS ... parts of every second with known state, see
+//   KNOWN_CARRIER_START_MS ... MSFBitThreshold
+//   NO_KNOWN_SILENCE_SECOND    second where they are not, or -1
+//   NO_KNOWN_CARRIER_SECOND
+//   FIRST_DECODED_SECOND       until then we can still join the minute
+//   DUT1_FIRST_SECOND          DUT1 is only valid if we got this one
+//   FIRST_CHECKED_SECOND ...   Bit A bits of the minute check and the parity
+//   CHECKED_PARITY_SECOND      covering them, see start_minute_check()
+//   CHECKED_PARITY_IN_B
+//   ParityGroups               MSFParityGroups of the time code
+//   SoftFrame                  soft bits kept for parity correction, see
+//                              MSFSoftBits
+//   SoftAccumulator            combines minutes, MSFSoftAccumulator<1> if not
+//   decode(frame)              MSFData of the frame, with the time of the
+//                              minute that starts at the next marker
+//   decode_unprotected(frame, data)  the fields without parity, for the
+//                              minutes combined from soft bits
+//   encode(data, frame)        the opposite of decode(), for the minute check
+//                              and the host signal generator
+//
+// Everything is a compile time constant, so a receiver only carries the code
+// of its own protocol and several receivers of different protocols can run
+// side by side, see the auto_detect example.
+
+/// @brief Parity group of a protocol as plain values, for the code that
+/// picks the group at run time, see MSFParityGroups::get()
+struct MSFParitySpan {
+  uint8_t startBit;
+  uint8_t numBits;
+  uint8_t parityBit;
+  bool parityInB;
+};
+
+/// @brief List of the parity groups of a time code, first one first
+/// @tparam GROUPS Parity groups, see MSFParityGroup
+template <class... GROUPS>
+struct MSFParityGroups;
+
+template <>
+struct MSFParityGroups<> {
+  static const uint8_t COUNT = 0;
+
+  static uint8_t failed(const MSFFrame&, uint8_t = 1) { return 0; }
+  static uint8_t covered(uint8_t, uint8_t = 1) { return 0; }
+  static bool get(uint8_t, MSFParitySpan&) { return false; }
+};
+
+template <class GROUP, class... REST>
+struct MSFParityGroups<GROUP, REST...> {
+  static const uint8_t COUNT = 1 + sizeof...(REST);
+  static_assert(COUNT <= 8, "MSFParityGroups takes up to 8 groups");
+
+  /// @brief Returns the groups failing their parity in given frame, bit per
+  /// group with the first one in bit 0
+  static uint8_t failed(const MSFFrame& frame, uint8_t bit = 1) {
+    return (frame.parity_ok<GROUP>() ? 0 : bit) | MSFParityGroups<REST...>::failed(frame, bit << 1);
+  }
+
+  /// @brief Returns what given groups cover, MSFSignalQuality parity flags
+  /// @param groups Groups as failed() returns them
+  static uint8_t covered(uint8_t groups, uint8_t bit = 1) {
+    return ((groups & bit) ? GROUP::COVERED : 0) |
+           MSFParityGroups<REST...>::covered(groups, bit << 1);
+  }
+
+  /// @brief Returns the group of given index
+  /// @return False if there is no such group
+  static bool get(uint8_t index, MSFParitySpan& span) {
+    if (index > 0) return MSFParityGroups<REST...>::get(index - 1, span);
+    span.startBit = GROUP::START_BIT;
+    span.numBits = GROUP::NUM_BITS;
+    span.parityBit = GROUP::PARITY_BIT_IDX;
+    span.parityInB = GROUP::IN_B;
+    return true;
+  }
+};
+
+/// @brief MSF from Anthorn, 60kHz. Bit A is carried between 100ms and 200ms
+/// of the second and Bit B between 200ms and 300ms, the defaults stay clear of
+/// both edges to leave room for slow receiver modules. Change them if your
+/// module is slower (or faster) than usual.
+/// @tparam BIT_A_START Start of Bit A window in milliseconds
+/// @tparam BIT_A_END End of Bit A window in milliseconds
+/// @tparam BIT_B_START Start of Bit B window in milliseconds
+/// @tparam BIT_B_END End of Bit B window in milliseconds
+template <uint16_t BIT_A_START = 135, uint16_t BIT_A_END = 165, uint16_t BIT_B_START = 235,
+          uint16_t BIT_B_END = 265>
+struct MSFProtocol {
+  static_assert(BIT_A_START >= 100 && BIT_A_START <= BIT_A_END && BIT_A_END < 200,
+                "Bit A window must be between 100ms and 200ms");
+  static_assert(BIT_B_START >= 200 && BIT_B_START <= BIT_B_END && BIT_B_END < 300,
+                "Bit B window must be between 200ms and 300ms");
+
+  static const bool INVERTED = false;
+  // second 59 has both bits 0, so 700ms of carrier followed by 500ms of
+  // silence in the 0th second is the minute marker
+  static const uint32_t MARKER_LEAD_SILENCE_MS = 0;
+  static const uint32_t MARKER_CARRIER_MS = 700;
+  static const uint32_t MARKER_SILENCE_MS = 500;
+  static const uint32_t MARKER_TRAIL_CARRIER_MS = 0;
+  static const uint32_t MINUTE_EDGE_SEARCH_BEFORE_MS = 250;
+
+  static const uint32_t BIT_A_START_MS = BIT_A_START;
+  static const uint32_t BIT_A_END_MS = BIT_A_END;
+  static const uint32_t BIT_B_START_MS = BIT_B_START;
+  static const uint32_t BIT_B_END_MS = BIT_B_END;
+  static const bool HAS_BIT_B = true;
+  static const bool BIT_A_INVERTED = false;
+  static const bool BIT_B_INVERTED = false;
+
+  // silence comes after the second edge search and before Bit A, carrier
+  // well after Bit B, apart from the 0th second which has silence there
+  static const uint32_t KNOWN_SILENCE_START_MS = 60;
+  static const uint32_t KNOWN_SILENCE_END_MS = 89;
+  static const uint32_t KNOWN_CARRIER_START_MS = 330;
+  static const uint32_t KNOWN_CARRIER_END_MS = 359;
+  static const int NO_KNOWN_SILENCE_SECOND = -1;
+  static const int NO_KNOWN_CARRIER_SECOND = 0;
+
+  // seconds before 17 carry DUT1, which we can do without
+  static const int FIRST_DECODED_SECOND = MSFTimeCode::Year::START_BIT;
+  static const int DUT1_FIRST_SECOND = MSFTimeCode::DUT1_POSITIVE_START_BIT;
+  static const int FIRST_CHECKED_SECOND = MSFTimeCode::Minute::START_BIT;
+  static const int LAST_CHECKED_A_SECOND =
+      MSFTimeCode::Minute::START_BIT + MSFTimeCode::Minute::NUM_BITS - 1;
+  static const int CHECKED_PARITY_SECOND = MSFTimeCode::TimeParity::PARITY_BIT_IDX;
+  static const bool CHECKED_PARITY_IN_B = true;
+
+  using ParityGroups =
+      MSFParityGroups<MSFTimeCode::YearParity, MSFTimeCode::DateParity,
+                      MSFTimeCode::DayOfTheWeekParity, MSFTimeCode::TimeParity>;
+  using SoftFrame = MSFSoftFrame;
+  using SoftAccumulator = MSFSoftAccumulator<MSF_TIME_LIB_SOFT_MINUTES>;
+
+  static MSFData decode(const MSFFrame& frame) { return frame.decode(); }
+  static void decode_unprotected(const MSFFrame& frame, MSFData& data) {
+    frame.decode_b_fields(data);
+  }
+  static void encode(const MSFData& data, MSFFrame& frame) { frame.encode(data); }
+};
+
+/// @brief Bit A and Bit B windows of MSF, the name MSFReceiver took them by
+/// before it decoded anything else, see MSFProtocol
+template <uint16_t BIT_A_START = 135, uint16_t BIT_A_END = 165, uint16_t BIT_B_START = 235,
+          uint16_t BIT_B_END = 265>
+using MSFBitWindows = MSFProtocol<BIT_A_START, BIT_A_END, BIT_B_START, BIT_B_END>;
+
+/// @brief DCF77 from Mainflingen, 77.5kHz. The carrier is reduced for 100ms
+/// (0) or 200ms (1) at the start of every second but the 59th, so a whole
+/// second of carrier followed by the 100ms of the 0th second is the minute
+/// marker. There is only Bit A, see DCF77TimeCode.
+/// @tparam BIT_A_START Start of Bit A window in milliseconds
+/// @tparam BIT_A_END End of Bit A window in milliseconds
+template <uint16_t BIT_A_START = 135, uint16_t BIT_A_END = 165>
+struct DCF77Protocol {
+  static_assert(BIT_A_START >= 100 && BIT_A_START <= BIT_A_END && BIT_A_END < 200,
+                "Bit A window must be between 100ms and 200ms");
+
+  static const bool INVERTED = false;
+  static const uint32_t MARKER_LEAD_SILENCE_MS = 0;
+  static const uint32_t MARKER_CARRIER_MS = 1000;
+  static const uint32_t MARKER_SILENCE_MS = 100;
+  static const uint32_t MARKER_TRAIL_CARRIER_MS = 0;
+  static const uint32_t MINUTE_EDGE_SEARCH_BEFORE_MS = 250;
+
+  static const uint32_t BIT_A_START_MS = BIT_A_START;
+  static const uint32_t BIT_A_END_MS = BIT_A_END;
+  static const uint32_t BIT_B_START_MS = 0;
+  static const uint32_t BIT_B_END_MS = 0;
+  static const bool HAS_BIT_B = false;
+  static const bool BIT_A_INVERTED = false;
+  static const bool BIT_B_INVERTED = false;
+
+  // the 59th second has no reduction, so no known silence either
+  static const uint32_t KNOWN_SILENCE_START_MS = 60;
+  static const uint32_t KNOWN_SILENCE_END_MS = 89;
+  static const uint32_t KNOWN_CARRIER_START_MS = 330;
+  static const uint32_t KNOWN_CARRIER_END_MS = 359;
+  static const int NO_KNOWN_SILENCE_SECOND = 59;
+  static const int NO_KNOWN_CARRIER_SECOND = -1;
+
+  // seconds before 16 carry weather and the call bit, which we dont decode
+  static const int FIRST_DECODED_SECOND = DCF77TimeCode::SUMMER_TIME_WARNING_BIT_IDX;
+  static const int DUT1_FIRST_SECOND = 0;
+  static const int FIRST_CHECKED_SECOND = DCF77TimeCode::Minute::START_BIT;
+  static const int LAST_CHECKED_A_SECOND =
+      DCF77TimeCode::Minute::START_BIT + DCF77TimeCode::Minute::NUM_BITS - 1;
+  static const int CHECKED_PARITY_SECOND = DCF77TimeCode::MinuteParity::PARITY_BIT_IDX;
+  static const bool CHECKED_PARITY_IN_B = false;
+
+  using ParityGroups = MSFParityGroups<DCF77TimeCode::MinuteParity, DCF77TimeCode::HourParity,
+                                       DCF77TimeCode::DateParity>;
+  using SoftFrame = MSFSoftBits<DCF77TimeCode::Minute::START_BIT,
+                                DCF77TimeCode::DateParity::PARITY_BIT_IDX, 0, 0>;
+  using SoftAccumulator = MSFSoftAccumulator<1>;
+
+  static void decode_unprotected(const MSFFrame& frame, MSFData& data) {
+    data.dut1 = 0;
+    data.dut1Valid = false;
+    data.summerTimeWarning = frame.a(DCF77TimeCode::SUMMER_TIME_WARNING_BIT_IDX);
+    data.summerTime = frame.a(DCF77TimeCode::SUMMER_TIME_BIT_IDX);
+  }
+
+  static MSFData decode(const MSFFrame& frame) {
+    MSFData decoded;
+    decoded.year += frame.bcd<DCF77TimeCode::Year>();
+    decoded.month = frame.bcd<DCF77TimeCode::Month>();
+    decoded.day = frame.bcd<DCF77TimeCode::Day>();
+    decoded.hour = frame.bcd<DCF77TimeCode::Hour>();
+    decoded.minute = frame.bcd<DCF77TimeCode::Minute>();
+    // 1 is Monday and 7 Sunday
+    int dayOfTheWeek = frame.bcd<DCF77TimeCode::DayOfTheWeek>();
+    decoded.dayOfTheWeek = dayOfTheWeek % 7 + 1;
+
+    // the fixed bits and the time zone bits are as good as a parity, exactly
+    // one of CET and CEST is in effect
+    bool framing = !frame.a(DCF77TimeCode::MINUTE_START_BIT_IDX) &&
+                   frame.a(DCF77TimeCode::TIME_START_BIT_IDX) &&
+                   frame.a(DCF77TimeCode::SUMMER_TIME_BIT_IDX) !=
+                       frame.a(DCF77TimeCode::STANDARD_TIME_BIT_IDX);
+    bool sane = (decoded.month >= 1 && decoded.month <= 12) &&
+                (decoded.day >= 1 && decoded.day <= 31) && (decoded.hour <= 23) &&
+                (decoded.minute <= 59) && (dayOfTheWeek >= 1 && dayOfTheWeek <= 7);
+
+    decoded.checksumPassed = ParityGroups::failed(frame) == 0 && framing && sane;
+    decode_unprotected(frame, decoded);
+    return decoded;
+  }
+
+  static void encode(const MSFData& data, MSFFrame& frame) {
+    frame.clear();
+    frame.set_a(DCF77TimeCode::TIME_START_BIT_IDX, true);
+    frame.set_a(DCF77TimeCode::SUMMER_TIME_WARNING_BIT_IDX, data.summerTimeWarning);
+    frame.set_a(DCF77TimeCode::SUMMER_TIME_BIT_IDX, data.summerTime);
+    frame.set_a(DCF77TimeCode::STANDARD_TIME_BIT_IDX, !data.summerTime);
+
+    frame.set_bcd<DCF77TimeCode::Year>(data.year % 100);
+    frame.set_bcd<DCF77TimeCode::Month>(data.month);
+    frame.set_bcd<DCF77TimeCode::Day>(data.day);
+    frame.set_bcd<DCF77TimeCode::DayOfTheWeek>((data.dayOfTheWeek + 5) % 7 + 1);
+    frame.set_bcd<DCF77TimeCode::Hour>(data.hour);
+    frame.set_bcd<DCF77TimeCode::Minute>(data.minute);
+
+    frame.set_parity<DCF77TimeCode::MinuteParity>();
+    frame.set_parity<DCF77TimeCode::HourParity>();
+    frame.set_parity<DCF77TimeCode::DateParity>();
+  }
+};
+
+/// @brief Minute, hour and day of the year of the WWVB and JJY time codes,
+/// which have them at the same places with a marker every 10 seconds. Both
+/// transmit the time of the minute the frame belongs to, so decode moves it a
+/// minute forward to match MSF and encode a minute back.
+/// @tparam TIME_CODE WWVBTimeCode or JJYTimeCode
+template <class TIME_CODE>
+struct MSFDayOfYearCode {
+  /// @brief Returns the seconds carrying a marker apart from the 0th one
+  static uint64_t markerMask() {
+    uint64_t mask = 0;
+    for (int second = TIME_CODE::MARKER_EVERY - 1; second < 60; second += TIME_CODE::MARKER_EVERY)
+      mask |= MSFFrame::secondMask(second);
+    return mask;
+  }
+
+  /// @brief Decodes minute, hour and the date from the day of the year, the
+  /// year has to be set already
+  /// @return False if the frame is not well formed or the time out of range
+  static bool decode_time(const MSFFrame& frame, MSFData& decoded) {
+    int minuteUnits = frame.bcd<typename TIME_CODE::MinuteUnits>();
+    int hourUnits = frame.bcd<typename TIME_CODE::HourUnits>();
+    int dayTens = frame.bcd<typename TIME_CODE::DayOfYearTens>();
+    int dayUnits = frame.bcd<typename TIME_CODE::DayOfYearUnits>();
+    decoded.minute = frame.bcd<typename TIME_CODE::MinuteTens>() * 10 + minuteUnits;
+    decoded.hour = frame.bcd<typename TIME_CODE::HourTens>() * 10 + hourUnits;
+    int dayOfYear =
+        frame.bcd<typename TIME_CODE::DayOfYearHundreds>() * 100 + dayTens * 10 + dayUnits;
+
+    // markers in Bit B exactly where they should be and nowhere else is what
+    // tells us we are not a second or more off. The receiver stops before
+    // the 59th one of WWVB, see MSFReceiver::LAST_SECOND.
+    const uint64_t unchecked = MSFFrame::secondMask(0) | MSFFrame::secondMask(59);
+    bool framing = (frame.bitB & ~unchecked) == (markerMask() & ~unchecked) &&
+                   (frame.bitA & TIME_CODE::ZERO_BITS) == 0;
+    bool digits = minuteUnits <= 9 && hourUnits <= 9 && dayTens <= 9 && dayUnits <= 9;
+    return framing && digits && decoded.minute <= 59 && decoded.hour <= 23 &&
+           decoded.set_day_of_year(dayOfYear);
+  }
+
+  /// @brief Returns the time of the minute a frame belongs to, a minute
+  /// before the time it decodes to
+  static MSFData frameTime(const MSFData& data) {
+    MSFData time = data;
+    if (time.minute > 0) {
+      time.minute--;
+      return time;
+    }
+    time.minute = 59;
+    if (time.hour > 0) {
+      time.hour--;
+      return time;
+    }
+    time.hour = 23;
+    int dayOfYear = data.day_of_year() - 1;
+    if (dayOfYear == 0) {
+      time.year--;
+      dayOfYear = MSFData::days_in_month(time.year, 2) == 29 ? 366 : 365;
+    }
+    time.set_day_of_year(dayOfYear);
+    return time;
+  }
+
+  /// @brief Clears the frame and encodes the markers, minute, hour and day of
+  /// the year of the frame time into it
+  static void encode_time(const MSFData& time, MSFFrame& frame) {
+    frame.clear();
+    // the markers are long enough to read as 1 in the Bit A window as well
+    frame.bitB = markerMask() | MSFFrame::secondMask(0);
+    frame.bitA = frame.bitB;
+    int dayOfYear = time.day_of_year();
+    frame.set_bcd<typename TIME_CODE::MinuteTens>(time.minute / 10);
+    frame.set_bcd<typename TIME_CODE::MinuteUnits>(time.minute % 10);
+    frame.set_bcd<typename TIME_CODE::HourTens>(time.hour / 10);
+    frame.set_bcd<typename TIME_CODE::HourUnits>(time.hour % 10);
+    frame.set_bcd<typename TIME_CODE::DayOfYearHundreds>(dayOfYear / 100);
+    frame.set_bcd<typename TIME_CODE::DayOfYearTens>(dayOfYear / 10 % 10);
+    frame.set_bcd<typename TIME_CODE::DayOfYearUnits>(dayOfYear % 10);
+  }
+};
+
+/// @brief WWVB from Fort Collins, 60kHz. The power is reduced for 200ms (0),
+/// 500ms (1) or 800ms (marker) at the start of every second and the 59th and
+/// 0th seconds are both markers, so 800ms of silence, 200ms of carrier and
+/// 800ms of silence again is the minute marker. Bit A is the bit and Bit B the
+/// marker, see WWVBTimeCode. This is the amplitude code, the phase modulation
+/// WWVB added in 2012 does not bother receiver modules built for it.
+/// @tparam BIT_A_START Start of Bit A window in milliseconds
+/// @tparam BIT_A_END End of Bit A window in milliseconds
+/// @tparam BIT_B_START Start of Bit B window in milliseconds
+/// @tparam BIT_B_END End of Bit B window in milliseconds
+template <uint16_t BIT_A_START = 335, uint16_t BIT_A_END = 365, uint16_t BIT_B_START = 635,
+          uint16_t BIT_B_END = 665>
+struct WWVBProtocol {
+  static_assert(BIT_A_START >= 200 && BIT_A_START <= BIT_A_END && BIT_A_END < 500,
+                "Bit A window must be between 200ms and 500ms");
+  static_assert(BIT_B_START >= 500 && BIT_B_START <= BIT_B_END && BIT_B_END < 800,
+                "Bit B window must be between 500ms and 800ms");
+
+  using Code = MSFDayOfYearCode<WWVBTimeCode>;
+
+  static const bool INVERTED = false;
+  static const uint32_t MARKER_LEAD_SILENCE_MS = 800;
+  static const uint32_t MARKER_CARRIER_MS = 200;
+  static const uint32_t MARKER_SILENCE_MS = 800;
+  static const uint32_t MARKER_TRAIL_CARRIER_MS = 0;
+  static const uint32_t MINUTE_EDGE_SEARCH_BEFORE_MS = 150;
+
+  static const uint32_t BIT_A_START_MS = BIT_A_START;
+  static const uint32_t BIT_A_END_MS = BIT_A_END;
+  static const uint32_t BIT_B_START_MS = BIT_B_START;
+  static const uint32_t BIT_B_END_MS = BIT_B_END;
+  static const bool HAS_BIT_B = true;
+  static const bool BIT_A_INVERTED = false;
+  static const bool BIT_B_INVERTED = false;
+
+  static const uint32_t KNOWN_SILENCE_START_MS = 60;
+  static const uint32_t KNOWN_SILENCE_END_MS = 89;
+  static const uint32_t KNOWN_CARRIER_START_MS = 880;
+  static const uint32_t KNOWN_CARRIER_END_MS = 909;
+  static const int NO_KNOWN_SILENCE_SECOND = -1;
+  static const int NO_KNOWN_CARRIER_SECOND = -1;
+
+  static const int FIRST_DECODED_SECOND = WWVBTimeCode::MinuteTens::START_BIT;
+  static const int DUT1_FIRST_SECOND = WWVBTimeCode::DUT1Sign::START_BIT;
+  static const int FIRST_CHECKED_SECOND = WWVBTimeCode::MinuteTens::START_BIT;
+  static const int LAST_CHECKED_A_SECOND = WWVBTimeCode::MinuteUnits::START_BIT + 3;
+  // there is no parity, the last minute bit takes its place
+  static const int CHECKED_PARITY_SECOND = LAST_CHECKED_A_SECOND;
+  static const bool CHECKED_PARITY_IN_B = false;
+
+  using ParityGroups = MSFParityGroups<>;
+  using SoftFrame = MSFSoftBits<0, 0, 0, 0>;
+  using SoftAccumulator = MSFSoftAccumulator<1>;
+
+  static void decode_unprotected(const MSFFrame& frame, MSFData& data) {
+    // 101 is positive and 010 negative
+    uint8_t sign = frame.raw<WWVBTimeCode::DUT1Sign>();
+    int magnitude = frame.bcd<WWVBTimeCode::DUT1>();
+    data.dut1 = sign == 0x02 ? -magnitude : magnitude;
+    data.dut1Valid = (sign == 0x05 || sign == 0x02) && magnitude <= 9;
+    // the status at the start of the UTC day, they differ for the whole day
+    // summer time changes
+    data.summerTime = frame.a(WWVBTimeCode::SUMMER_TIME_BIT_IDX);
+    data.summerTimeWarning = frame.a(WWVBTimeCode::SUMMER_TIME_TONIGHT_BIT_IDX) != data.summerTime;
+  }
+
+  static MSFData decode(const MSFFrame& frame) {
+    MSFData decoded;
+    int yearTens = frame.bcd<WWVBTimeCode::YearTens>();
+    int yearUnits = frame.bcd<WWVBTimeCode::YearUnits>();
+    decoded.year += yearTens * 10 + yearUnits;
+    bool leapYear = MSFData::days_in_month(decoded.year, 2) == 29;
+    decoded.checksumPassed = yearTens <= 9 && yearUnits <= 9 &&
+                             frame.a(WWVBTimeCode::LEAP_YEAR_BIT_IDX) == leapYear &&
+                             Code::decode_time(frame, decoded);
+    decode_unprotected(frame, decoded);
+    if (decoded.checksumPassed) decoded.add_minutes(1);
+    return decoded;
+  }
+
+  static void encode(const MSFData& data, MSFFrame& frame) {
+    MSFData time = Code::frameTime(data);
+    Code::encode_time(time, frame);
+    int year = time.year % 100;
+    frame.set_bcd<WWVBTimeCode::YearTens>(year / 10);
+    frame.set_bcd<WWVBTimeCode::YearUnits>(year % 10);
+    frame.set_a(WWVBTimeCode::LEAP_YEAR_BIT_IDX, MSFData::days_in_month(time.year, 2) == 29);
+
+    const int signBit = WWVBTimeCode::DUT1Sign::START_BIT;
+    frame.set_a(signBit, data.dut1 >= 0);
+    frame.set_a(signBit + 1, data.dut1 < 0);
+    frame.set_a(signBit + 2, data.dut1 >= 0);
+    frame.set_bcd<WWVBTimeCode::DUT1>(abs(data.dut1) < 9 ? abs(data.dut1) : 9);
+    // a warning means it changes today, so tonight it is the other way round
+    frame.set_a(WWVBTimeCode::SUMMER_TIME_BIT_IDX, data.summerTime);
+    frame.set_a(WWVBTimeCode::SUMMER_TIME_TONIGHT_BIT_IDX,
+                data.summerTime != data.summerTimeWarning);
+  }
+};
+
+/// @brief JJY from Mount Otakadoya (40kHz) and Mount Hagane (60kHz). The
+/// power is raised for 800ms (0), 500ms (1) or 200ms (marker) at the start of
+/// every second, the reads are inverted so the second starts with "silence" as
+/// on the other signals. The 59th and 0th seconds are both markers, so 800ms
+/// of carrier, 200ms of silence and 800ms of carrier again are the minute
+/// marker. Bit A is the bit and Bit B the marker, both inverted as a 1 and a
+/// marker are carrier where a 0 is not, see JJYTimeCode.
+/// @tparam BIT_A_START Start of Bit A window in milliseconds
+/// @tparam BIT_A_END End of Bit A window in milliseconds
+/// @tparam BIT_B_START Start of Bit B window in milliseconds
+/// @tparam BIT_B_END End of Bit B window in milliseconds
+template <uint16_t BIT_A_START = 635, uint16_t BIT_A_END = 665, uint16_t BIT_B_START = 335,
+          uint16_t BIT_B_END = 365>
+struct JJYProtocol {
+  static_assert(BIT_A_START >= 500 && BIT_A_START <= BIT_A_END && BIT_A_END < 800,
+                "Bit A window must be between 500ms and 800ms");
+  static_assert(BIT_B_START >= 200 && BIT_B_START <= BIT_B_END && BIT_B_END < 500,
+                "Bit B window must be between 200ms and 500ms");
+
+  using Code = MSFDayOfYearCode<JJYTimeCode>;
+
+  static const bool INVERTED = true;
+  static const uint32_t MARKER_LEAD_SILENCE_MS = 0;
+  static const uint32_t MARKER_CARRIER_MS = 800;
+  static const uint32_t MARKER_SILENCE_MS = 200;
+  static const uint32_t MARKER_TRAIL_CARRIER_MS = 800;
+  static const uint32_t MINUTE_EDGE_SEARCH_BEFORE_MS = 250;
+
+  static const uint32_t BIT_A_START_MS = BIT_A_START;
+  static const uint32_t BIT_A_END_MS = BIT_A_END;
+  static const uint32_t BIT_B_START_MS = BIT_B_START;
+  static const uint32_t BIT_B_END_MS = BIT_B_END;
+  static const bool HAS_BIT_B = true;
+  static const bool BIT_A_INVERTED = true;
+  static const bool BIT_B_INVERTED = true;
+
+  static const uint32_t KNOWN_SILENCE_START_MS = 60;
+  static const uint32_t KNOWN_SILENCE_END_MS = 89;
+  static const uint32_t KNOWN_CARRIER_START_MS = 880;
+  static const uint32_t KNOWN_CARRIER_END_MS = 909;
+  static const int NO_KNOWN_SILENCE_SECOND = -1;
+  static const int NO_KNOWN_CARRIER_SECOND = -1;
+
+  static const int FIRST_DECODED_SECOND = JJYTimeCode::MinuteTens::START_BIT;
+  static const int DUT1_FIRST_SECOND = 0;
+  static const int FIRST_CHECKED_SECOND = JJYTimeCode::MinuteTens::START_BIT;
+  static const int LAST_CHECKED_A_SECOND = JJYTimeCode::MinuteUnits::START_BIT + 3;
+  static const int CHECKED_PARITY_SECOND = JJYTimeCode::MinuteParity::PARITY_BIT_IDX;
+  static const bool CHECKED_PARITY_IN_B = false;
+
+  using ParityGroups = MSFParityGroups<JJYTimeCode::HourParity, JJYTimeCode::MinuteParity>;
+  using SoftFrame = MSFSoftBits<JJYTimeCode::MinuteTens::START_BIT,
+                                JJYTimeCode::MinuteParity::PARITY_BIT_IDX, 0, 0>;
+  using SoftAccumulator = MSFSoftAccumulator<1>;
+
+  static void decode_unprotected(const MSFFrame&, MSFData& data) {
+    data.dut1 = 0;
+    data.dut1Valid = false;
+    data.summerTime = false;
+    data.summerTimeWarning = false;
+  }
+
+  static MSFData decode(const MSFFrame& frame) {
+    MSFData decoded;
+    uint8_t rawYear = frame.raw<JJYTimeCode::Year>();
+    decoded.year += frame.bcd<JJYTimeCode::Year>();
+    int dayOfTheWeek = frame.bcd<JJYTimeCode::DayOfTheWeek>();
+    // the day of the week we get from the day of the year has to match the
+    // transmitted one, the call sign minutes have neither
+    decoded.checksumPassed = (rawYear >> 4) <= 9 && (rawYear & 0x0F) <= 9 &&
+                             ParityGroups::failed(frame) == 0 &&
+                             Code::decode_time(frame, decoded) &&
+                             decoded.dayOfTheWeek == dayOfTheWeek + 1 &&
+                             decoded.minute != JJYTimeCode::CALL_SIGN_MINUTE &&
+                             decoded.minute != JJYTimeCode::CALL_SIGN_MINUTE_2;
+    decode_unprotected(frame, decoded);
+    if (decoded.checksumPassed) decoded.add_minutes(1);
+    return decoded;
+  }
+
+  static void encode(const MSFData& data, MSFFrame& frame) {
+    MSFData time = Code::frameTime(data);
+    Code::encode_time(time, frame);
+    frame.set_parity<JJYTimeCode::HourParity>();
+    frame.set_parity<JJYTimeCode::MinuteParity>();
+    if (time.minute == JJYTimeCode::CALL_SIGN_MINUTE ||
+        time.minute == JJYTimeCode::CALL_SIGN_MINUTE_2)
+      return;
+    frame.set_bcd<JJYTimeCode::Year>(time.year % 100);
+    frame.set_bcd<JJYTimeCode::DayOfTheWeek>(time.dayOfTheWeek - 1);
+  }
+};
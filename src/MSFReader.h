@@ -0,0 +1,183 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Number of reader functions (receiver modules or antennas) a single
+// MSFReceiver can combine, see MSFReceiver constructor taking an array of
+// readers and MSFDiversity. With more than one every input takes the rolling
+// buffer once more (150 bytes on MSFReceiver<1>, 15 on MSFReceiver<10>) plus
+// 8 bytes, with 1 there is nothing to keep.
+#ifndef MSF_TIME_LIB_DIVERSITY_INPUTS
+#define MSF_TIME_LIB_DIVERSITY_INPUTS 1
+#endif
+
+// Reader policies tell MSFReceiver how to read the carrier state, they are
+// passed to it as its READER template parameter. Every policy has:
+//
+//   static const uint8_t INPUTS;  // receiver modules read at once, 1 to 8
+//   uint8_t read();               // carrier state, bit per module, set for
+//                                 // carrier and first module in bit 0
+//
+// read() can be static, it is called for every sample so anything it does
+// counts against the sampling budget. The default MSFFunctionReader calls the
+// reader function given to the constructor, the port readers below read the
+// pin register straight away and inline to a couple of instructions. There is
+// no digitalRead() and no call through a pointer, on AVR that is cca 50
+// cycles less per sample.
+//
+// The register is given by its address, as pointers can not be template
+// parameters. It is the data memory address of the datasheet register
+// summary on AVR (PIND of ATmega328P is 0x29), the IN register of the PORT
+// group on SAMD (0x41004420 for group A of SAMD21, with uint32_t register) and
+// GPIO_IN_REG on ESP32 (with uint32_t register).
+
+/// @brief Reads the carrier state through reader functions, the default
+/// reader policy of MSFReceiver
+/// @tparam MAX_INPUTS Number of reader functions it can take, see
+/// MSF_TIME_LIB_DIVERSITY_INPUTS
+template <uint8_t MAX_INPUTS = MSF_TIME_LIB_DIVERSITY_INPUTS>
+class MSFFunctionReader {
+  static_assert(MAX_INPUTS >= 1 && MAX_INPUTS <= 8, "MSF_TIME_LIB_DIVERSITY_INPUTS must be 1 to 8");
+  using ReaderFunction = bool (*)();
+
+  ReaderFunction single = nullptr;
+  const ReaderFunction* readers = nullptr;
+  uint8_t count = 1;
+
+ public:
+  static const uint8_t INPUTS = MAX_INPUTS;
+
+  MSFFunctionReader() {}
+  MSFFunctionReader(ReaderFunction readerFunc) : single(readerFunc) {}
+
+  /// @param readerFuncs Reader functions, the array has to outlive the reader
+  /// @param readerCount Number of reader functions, the ones past MAX_INPUTS
+  /// are ignored
+  MSFFunctionReader(const ReaderFunction* readerFuncs, uint8_t readerCount)
+      : readers(readerFuncs), count(readerCount < MAX_INPUTS ? readerCount : MAX_INPUTS) {}
+
+  /// @brief Returns how many reader functions there are
+  uint8_t get_count() const { return this->count; }
+
+  uint8_t read() {
+    if (this->readers == nullptr) return this->single();
+    uint8_t reads = 0;
+    for (uint8_t i = 0; i < this->count; i++) {
+      if (this->readers[i]()) reads |= 1 << i;
+    }
+    return reads;
+  }
+};
+
+/// @brief Single reader function, nothing to loop over and nothing to keep
+/// but the function
+template <>
+class MSFFunctionReader<1> {
+  using ReaderFunction = bool (*)();
+
+  ReaderFunction single = nullptr;
+
+ public:
+  static const uint8_t INPUTS = 1;
+
+  MSFFunctionReader() {}
+  MSFFunctionReader(ReaderFunction readerFunc) : single(readerFunc) {}
+  MSFFunctionReader(const ReaderFunction* readerFuncs, uint8_t) : single(readerFuncs[0]) {}
+
+  uint8_t get_count() const { return 1; }
+
+  uint8_t read() { return this->single(); }
+};
+
+/// @brief Tells if a reader policy reads through reader functions, which
+/// MSFReceiver then has to be given. Every other policy finds the carrier on
+/// its own.
+template <class READER>
+struct MSFReaderNeedsFunction {
+  static const bool value = false;
+};
+
+template <uint8_t MAX_INPUTS>
+struct MSFReaderNeedsFunction<MSFFunctionReader<MAX_INPUTS>> {
+  static const bool value = true;
+};
+
+/// @brief Reads the carrier state of a single receiver module from its pin
+/// register
+/// @tparam ADDRESS Address of the input register of the port, see above
+/// @tparam MASK Bit of the pin within the register
+/// @tparam CARRIER_LEVEL Level of the pin with carrier, most modules pull
+/// their output LOW while they receive it
+/// @tparam REGISTER Type of the register, uint32_t on 32 bit ports
+template <uintptr_t ADDRESS, uint32_t MASK, bool CARRIER_LEVEL = LOW, class REGISTER = uint8_t>
+struct MSFPinReader {
+  static const uint8_t INPUTS = 1;
+
+  static uint8_t read() {
+    bool high = *reinterpret_cast<volatile REGISTER*>(ADDRESS) & MASK;
+    return high == CARRIER_LEVEL;
+  }
+};
+
+/// @brief Reads the carrier state of several receiver modules on the same
+/// port with a single read of its register, for one MSFReceiver combining
+/// them, see MSFDiversity
+/// @tparam ADDRESS Address of the input register of the port, see above
+/// @tparam REGISTER Type of the register, uint32_t on 32 bit ports
+/// @tparam CARRIER_LEVEL Level of the pins with carrier
+/// @tparam MASKS Bit of the pin of every module within the register
+template <uintptr_t ADDRESS, class REGISTER, bool CARRIER_LEVEL, uint32_t... MASKS>
+class MSFPortReader {
+  /// @brief Returns the bits of the modules from given one on, the masks are
+  /// constants so this unrolls to a bit test per module
+  static uint8_t collect(REGISTER, uint8_t) { return 0; }
+
+  template <class... REST>
+  static uint8_t collect(REGISTER port, uint8_t bit, uint32_t mask, REST... rest) {
+    return (((port & mask) != 0) == CARRIER_LEVEL ? bit : 0) | collect(port, bit << 1, rest...);
+  }
+
+ public:
+  static const uint8_t INPUTS = sizeof...(MASKS);
+  static_assert(INPUTS >= 1 && INPUTS <= 8, "MSFPortReader takes 1 to 8 pins");
+
+  static uint8_t read() {
+    REGISTER port = *reinterpret_cast<volatile REGISTER*>(ADDRESS);
+    return collect(port, 1, MASKS...);
+  }
+};
+
+/// @brief Reads a port register once for several MSFReceivers, each of them
+/// decoding a module on its own pin. Call sample() right before ticking the
+/// receivers, every one of them then takes its pin from the same read.
+///
+///   using Port = MSFPortSnapshot<0x23>;
+///   MSFReceiver<1, MSFBitWindows<>, 1, MSF_TIME_LIB_OBSERVER, Port::Pin<_BV(0)>> msfA;
+///   MSFReceiver<1, MSFBitWindows<>, 1, MSF_TIME_LIB_OBSERVER, Port::Pin<_BV(1)>> msfB;
+///
+///   Port::sample();
+///   msfA.tick();
+///   msfB.tick();
+/// @tparam ADDRESS Address of the input register of the port, see above
+/// @tparam REGISTER Type of the register, uint32_t on 32 bit ports
+template <uintptr_t ADDRESS, class REGISTER = uint8_t>
+struct MSFPortSnapshot {
+  /// @brief Returns the register as of the last sample()
+  static REGISTER& value() {
+    static REGISTER port = 0;
+    return port;
+  }
+
+  /// @brief Reads the register
+  static void sample() { value() = *reinterpret_cast<volatile REGISTER*>(ADDRESS); }
+
+  /// @brief Reader policy taking one pin from the last sample()
+  /// @tparam MASK Bit of the pin within the register
+  /// @tparam CARRIER_LEVEL Level of the pin with carrier
+  template <uint32_t MASK, bool CARRIER_LEVEL = LOW>
+  struct Pin {
+    static const uint8_t INPUTS = 1;
+
+    static uint8_t read() { return ((value() & MASK) != 0) == CARRIER_LEVEL; }
+  };
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Size of a block of the sample buffer in bytes, a block holds 8 samples per
+// byte and is handed to the receiver in one go. The default of 32 bytes at 2kHz
+// is a block every 128ms.
+#ifndef MSF_TIME_LIB_SAMPLE_BLOCK_BYTES
+#define MSF_TIME_LIB_SAMPLE_BLOCK_BYTES 32
+#endif
+
+// Number of blocks of the sample buffer, tick() has to drain them before they
+// all fill up. Must be a power of two and at most 128.
+#ifndef MSF_TIME_LIB_SAMPLE_BLOCKS
+#define MSF_TIME_LIB_SAMPLE_BLOCKS 4
+#endif
+
+/// @brief Lock-free single producer single consumer ring of packed sample
+/// blocks, filled by hardware at a fixed sample rate. The producer is a
+/// timer interrupt calling push_sample(), or a DMA (SPI, I2S, timer capture)
+/// filling get_fill_block() and its completion interrupt calling
+/// push_block(). The consumer is MSFReceiver::tick() which takes the carrier
+/// state of every sample it needs from the blocks, so the CPU only wakes up
+/// once per block instead of for every sample.
+///
+/// Samples are the raw levels of the input pin, most significant bit of the
+/// first byte first, the way SPI and I2S shift them in.
+class MSFSampleBuffer {
+  static const uint8_t BLOCKS = MSF_TIME_LIB_SAMPLE_BLOCKS;
+  static const uint8_t MASK = BLOCKS - 1;
+  static const uint16_t BLOCK_BYTES = MSF_TIME_LIB_SAMPLE_BLOCK_BYTES;
+  static const uint16_t BLOCK_SAMPLES = BLOCK_BYTES * 8;
+  static_assert(BLOCKS >= 2 && BLOCKS <= 128 && (BLOCKS & MASK) == 0,
+                "MSF_TIME_LIB_SAMPLE_BLOCKS must be a power of two between 2 and 128");
+  static_assert(BLOCK_BYTES >= 1 && BLOCK_BYTES <= 1024,
+                "MSF_TIME_LIB_SAMPLE_BLOCK_BYTES must be between 1 and 1024");
+
+  uint8_t blocks[BLOCKS][BLOCK_BYTES];
+  // micros() timestamp of the first sample of every block
+  volatile uint32_t blockStarts[BLOCKS];
+
+  // head is only written by the producer and tail only by the consumer, both
+  // are single byte so reads and writes are atomic even on 8 bit AVR
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+  volatile bool overflowed = false;
+  volatile bool started = false;
+
+  const uint32_t samplePeriod;
+  const uint32_t blockDuration;
+  const bool carrierLevel;
+
+  // samples push_sample() wrote into the head block so far
+  uint16_t filledSamples = 0;
+
+  // sample of the tail block the consumer is at and its timestamp, we only
+  // ever move forward so this saves us a division per read
+  uint16_t readIdx = 0;
+  uint32_t readAt = 0;
+  bool reading = false;
+
+  /// @brief Removes the oldest block from the buffer
+  void popBlock() {
+    this->tail = (this->tail + 1) & MASK;
+    this->reading = false;
+  }
+
+ public:
+  /// @param samplePeriodUs Time between two samples in microseconds, up to
+  /// 500 the Bit A/B windows get all the samples they take
+  /// @param carrierLevelOfPin Level of the pin with carrier, most modules pull
+  /// their output LOW while they receive it
+  MSFSampleBuffer(uint32_t samplePeriodUs, bool carrierLevelOfPin = LOW)
+      : samplePeriod(samplePeriodUs),
+        blockDuration(samplePeriodUs * BLOCK_SAMPLES),
+        carrierLevel(carrierLevelOfPin) {}
+
+  /// @brief Returns the block the producer fills next, for the DMA to write
+  /// BLOCK_BYTES into
+  /// @return Nullptr if the buffer is full, the samples have to be dropped
+  uint8_t* get_fill_block() {
+    uint8_t currentHead = this->head;
+    if (((currentHead + 1) & MASK) == this->tail) {
+      this->overflowed = true;
+      return nullptr;
+    }
+    return this->blocks[currentHead];
+  }
+
+  /// @brief Hands the block returned by get_fill_block() to the receiver.
+  /// Meant to be called from the DMA completion interrupt.
+  /// @param endMicros micros() timestamp one sample period after the last
+  /// sample of the block, which is when the completion interrupt fires
+  /// @return False if the buffer is full and the block was dropped
+  bool push_block(uint32_t endMicros) {
+    uint8_t currentHead = this->head;
+    uint8_t nextHead = (currentHead + 1) & MASK;
+    if (nextHead == this->tail) {
+      this->overflowed = true;
+      return false;
+    }
+    this->blockStarts[currentHead] = endMicros - this->blockDuration;
+    // only publish the new head once the block is stamped
+    this->head = nextHead;
+    this->started = true;
+    return true;
+  }
+
+  /// @brief Adds one sample to the block being filled, pushing it once it is
+  /// full. Meant to be called from a timer interrupt every sample period,
+  /// about as cheap as such interrupt can be.
+  /// @param level Level of the input pin
+  void push_sample(bool level) {
+    uint8_t* block = this->get_fill_block();
+    if (block == nullptr) return;
+    uint8_t bit = 0x80 >> (this->filledSamples & 7);
+    if (level)
+      block[this->filledSamples >> 3] |= bit;
+    else
+      block[this->filledSamples >> 3] &= ~bit;
+    if (++this->filledSamples < BLOCK_SAMPLES) return;
+    this->filledSamples = 0;
+    this->push_block(micros() + this->samplePeriod);
+  }
+
+  /// @brief Returns the carrier state at given time, that is of the last
+  /// sample taken up to that time. Samples before it are dropped, so ask in
+  /// order of time.
+  /// @param timestampMicros micros() timestamp of the read
+  /// @param carrier Output, carrier state at that time
+  /// @return False if that sample is not in the buffer yet
+  bool carrier_at(uint32_t timestampMicros, bool& carrier) {
+    while (this->tail != this->head) {
+      uint8_t currentTail = this->tail;
+      if (!this->reading) {
+        this->readIdx = 0;
+        this->readAt = this->blockStarts[currentTail];
+        this->reading = true;
+      }
+      // the whole block is older, skip it without going through its samples
+      if ((int32_t)(timestampMicros - (this->blockStarts[currentTail] + this->blockDuration)) >=
+          0) {
+        this->popBlock();
+        continue;
+      }
+      while ((int32_t)(timestampMicros - (this->readAt + this->samplePeriod)) >= 0) {
+        this->readIdx++;
+        this->readAt += this->samplePeriod;
+      }
+      bool level = this->blocks[currentTail][this->readIdx >> 3] & (0x80 >> (this->readIdx & 7));
+      carrier = level == this->carrierLevel;
+      return true;
+    }
+    return false;
+  }
+
+  /// @brief Drops the blocks that ended before given time, the receiver does
+  /// this while it does not need any samples
+  /// @param timestampMicros micros() timestamp to drop the blocks up to
+  void drop_until(uint32_t timestampMicros) {
+    while (this->tail != this->head &&
+           (int32_t)(timestampMicros - (this->blockStarts[this->tail] + this->blockDuration)) >= 0)
+      this->popBlock();
+  }
+
+  /// @brief Returns the micros() timestamp the samples reach up to, which is
+  /// the end of the last pushed block. The producer does not write its stamp
+  /// again until the whole ring went around, so it stays valid once the block
+  /// is consumed.
+  /// @return False if no block was pushed yet
+  bool get_end(uint32_t& timestampMicros) const {
+    if (!this->started) return false;
+    uint8_t currentHead = this->head;
+    timestampMicros = this->blockStarts[(currentHead - 1) & MASK] + this->blockDuration;
+    return true;
+  }
+
+  /// @brief Returns how long a block takes to fill in microseconds
+  uint32_t get_block_duration() const { return this->blockDuration; }
+
+  /// @brief Checks if any samples were dropped because the buffer was full,
+  /// and clears the flag
+  /// @return True if samples were dropped since last call
+  bool check_and_clear_overflow() {
+    bool result = this->overflowed;
+    this->overflowed = false;
+    return result;
+  }
+};
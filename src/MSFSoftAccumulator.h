@@ -0,0 +1,241 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+#include "MSFFrame.h"
+#include "MSFTimeCode.h"
+
+// Number of consecutive minutes MSFSoftAccumulator keeps to combine them when
+// a single minute does not pass the checksum. Every minute takes 39 bytes of
+// RAM, set to 1 to disable combining minutes. Only MSF combines minutes, see
+// MSFProtocol.h.
+#ifndef MSF_TIME_LIB_SOFT_MINUTES
+#define MSF_TIME_LIB_SOFT_MINUTES 3
+#endif
+
+/// @brief Soft confidence of the bits of one minute, from -100 (surely 0) to
+/// 100 (surely 1), 0 means we know nothing about the bit. Only the bits we
+/// decode are kept, see MSFSoftFrame for the ones of MSF.
+/// @tparam FIRST_A First second of the kept Bit A bits
+/// @tparam LAST_A Last second of the kept Bit A bits
+/// @tparam FIRST_B First second of the kept Bit B bits
+/// @tparam LAST_B Last second of the kept Bit B bits
+template <uint8_t FIRST_A, uint8_t LAST_A, uint8_t FIRST_B, uint8_t LAST_B>
+struct MSFSoftBits {
+  static_assert(FIRST_A <= LAST_A && FIRST_B <= LAST_B && LAST_A < 60 && LAST_B < 60,
+                "MSFSoftBits must keep seconds of the minute in order");
+
+  static const uint8_t FIRST_A_BIT = FIRST_A;
+  static const uint8_t LAST_A_BIT = LAST_A;
+  static const uint8_t FIRST_B_BIT = FIRST_B;
+  static const uint8_t LAST_B_BIT = LAST_B;
+
+  int8_t bitA[LAST_A_BIT - FIRST_A_BIT + 1];
+  int8_t bitB[LAST_B_BIT - FIRST_B_BIT + 1];
+
+  /// @brief Sets all the bits to unknown
+  void clear() {
+    memset(this->bitA, 0, sizeof(this->bitA));
+    memset(this->bitB, 0, sizeof(this->bitB));
+  }
+
+  /// @brief Stores the confidence of Bit A and Bit B of given second, bits we
+  /// dont keep are ignored
+  /// @param second Second of the minute (0-59)
+  /// @param confidenceA Confidence of Bit A (-100 to 100)
+  /// @param confidenceB Confidence of Bit B (-100 to 100)
+  void set(int second, int8_t confidenceA, int8_t confidenceB) {
+    if (second >= FIRST_A_BIT && second <= LAST_A_BIT)
+      this->bitA[second - FIRST_A_BIT] = confidenceA;
+    if (second >= FIRST_B_BIT && second <= LAST_B_BIT)
+      this->bitB[second - FIRST_B_BIT] = confidenceB;
+  }
+
+  /// @brief Returns the confidence of Bit A of given kept second
+  int8_t a(int second) const { return this->bitA[second - FIRST_A_BIT]; }
+
+  /// @brief Returns the confidence of Bit B of given kept second
+  int8_t b(int second) const { return this->bitB[second - FIRST_B_BIT]; }
+};
+
+/// @brief Soft bits MSF decodes, that is Bit A of seconds 17 to 51 and Bit B
+/// (parity) of seconds 54 to 57
+using MSFSoftFrame = MSFSoftBits<17, 51, 54, 57>;
+
+/// @brief Keeps soft bits of the last few consecutive minutes and decodes them
+/// together, so the noise in one minute can be outvoted by the others. This is
+/// what lets us decode weak signal where almost every single minute has a bad
+/// bit or two.
+///
+/// Date bits stay the same from minute to minute, so we simply add them up.
+/// Hour and minute change every minute, so instead we try every possible time
+/// of the newest minute, line up the older minutes by counting back from it
+/// and pick the time all of them agree with the most. Minutes around the
+/// change to and from summer time do not line up and just fail to decode.
+/// @tparam MINUTES Number of minutes to keep
+template <uint8_t MINUTES>
+class MSFSoftAccumulator {
+  static_assert(MINUTES >= 1, "MSFSoftAccumulator needs to keep at least one minute");
+
+  static const int MINUTES_PER_DAY = 24 * 60;
+  // time bits are hour and minute in Bit A followed by their parity in Bit B
+  static const int FIRST_TIME_BIT = MSFTimeCode::TimeParity::START_BIT;
+  static const int NUM_TIME_BITS = MSFTimeCode::TimeParity::NUM_BITS;
+
+  MSFSoftFrame frames[MINUTES];
+  uint8_t newest = 0;
+  uint8_t count = 0;
+
+  /// @brief Returns the frame captured given number of minutes before the
+  /// newest one
+  const MSFSoftFrame& frame(uint8_t minutesAgo) const {
+    return this->frames[(this->newest + MINUTES - minutesAgo) % MINUTES];
+  }
+
+  /// @brief Returns the hour and minute bits as they are transmitted in Bit A
+  /// of seconds 39 to 51, second 39 being the highest bit
+  /// @param minuteOfDay Time to encode, minutes since midnight
+  static uint16_t encodeTime(int minuteOfDay) {
+    uint8_t hour = minuteOfDay / 60;
+    uint8_t minute = minuteOfDay % 60;
+    uint16_t hourBCD = ((hour / 10) << 4) | (hour % 10);
+    uint16_t minuteBCD = ((minute / 10) << 4) | (minute % 10);
+    return (hourBCD << 7) | minuteBCD;
+  }
+
+  /// @brief Fills in the time bits of every kept minute if the newest minute
+  /// is at given time
+  /// @param minuteOfDay Time of the newest minute, minutes since midnight
+  /// @param codes Output, see encodeTime()
+  void encodeKeptMinutes(int minuteOfDay, uint16_t* codes) const {
+    for (uint8_t k = 0; k < this->count; k++)
+      codes[k] = encodeTime((minuteOfDay + MINUTES_PER_DAY - k) % MINUTES_PER_DAY);
+  }
+
+  /// @brief Adds up how much the kept minutes agree with the expected value of
+  /// one time bit, positive if they agree
+  /// @param codes Expected time bits of every kept minute, see encodeTime()
+  /// @param bit Index of the time bit, 0 to 12 for Bit A of seconds 39 to 51
+  /// and 13 for the parity in Bit B of second 57
+  int32_t timeBitAgreement(const uint16_t* codes, int bit) const {
+    int32_t sum = 0;
+    for (uint8_t k = 0; k < this->count; k++) {
+      bool expected;
+      int8_t confidence;
+      if (bit < NUM_TIME_BITS) {
+        expected = (codes[k] >> (NUM_TIME_BITS - 1 - bit)) & 1;
+        confidence = this->frame(k).a(FIRST_TIME_BIT + bit);
+      } else {
+        // odd parity, so the parity bit is 1 when there is even number of ones
+        expected = (__builtin_popcount(codes[k]) % 2) == 0;
+        confidence = this->frame(k).b(MSFTimeCode::TimeParity::PARITY_BIT_IDX);
+      }
+      sum += expected ? confidence : -confidence;
+    }
+    return sum;
+  }
+
+  /// @brief Adds up Bit A of given second over the given number of newest
+  /// minutes and returns the bit it most likely is
+  bool dateBit(int second, uint8_t minutes) const {
+    int32_t sum = 0;
+    for (uint8_t k = 0; k < minutes; k++) sum += this->frame(k).a(second);
+    return sum > 0;
+  }
+
+  /// @brief Same as dateBit() but for the parity bits in Bit B
+  bool dateParityBit(int second, uint8_t minutes) const {
+    int32_t sum = 0;
+    for (uint8_t k = 0; k < minutes; k++) sum += this->frame(k).b(second);
+    return sum > 0;
+  }
+
+ public:
+  /// @brief Adds the newest minute, the oldest one is dropped if we already
+  /// keep MINUTES of them. The minutes must follow each other, call reset()
+  /// if one was skipped.
+  /// @param softFrame Soft bits of the minute
+  void add(const MSFSoftFrame& softFrame) {
+    this->newest = (this->newest + 1) % MINUTES;
+    this->frames[this->newest] = softFrame;
+    if (this->count < MINUTES) this->count++;
+  }
+
+  /// @brief Drops all kept minutes
+  void reset() { this->count = 0; }
+
+  /// @brief Returns number of minutes currently kept
+  uint8_t get_count() const { return this->count; }
+
+  /// @brief Decodes the time of the newest minute from all kept minutes
+  /// @return Struct containing decoded time and checksum result, the checksum
+  /// only passes if every time bit added up over all the minutes agrees with
+  /// the decoded time and the added up date bits pass their parity checks.
+  MSFData decode() const {
+    if (this->count == 0) {
+      MSFData nothing;
+      nothing.checksumPassed = false;
+      return nothing;
+    }
+
+    uint16_t codes[MINUTES];
+    int bestMinuteOfDay = 0;
+    int32_t bestScore = 0;
+    for (int minuteOfDay = 0; minuteOfDay < MINUTES_PER_DAY; minuteOfDay++) {
+      this->encodeKeptMinutes(minuteOfDay, codes);
+      int32_t score = 0;
+      for (int bit = 0; bit <= NUM_TIME_BITS; bit++) score += this->timeBitAgreement(codes, bit);
+      if (minuteOfDay == 0 || score > bestScore) {
+        bestScore = score;
+        bestMinuteOfDay = minuteOfDay;
+      }
+    }
+
+    // the best time is not good enough on its own, every single bit has to
+    // agree with it, for a single minute this is the same as passing parity
+    this->encodeKeptMinutes(bestMinuteOfDay, codes);
+    bool pTime = true;
+    for (int bit = 0; bit <= NUM_TIME_BITS; bit++) {
+      if (this->timeBitAgreement(codes, bit) <= 0) pTime = false;
+    }
+
+    // build the most likely frame and let it decode itself, the time bits come
+    // from the best time and the date bits from adding up minutes of the same
+    // day, as the date changes at midnight
+    MSFFrame likely;
+    likely.clear();
+    // encodeTime() gives the bits in the same order MSFFrame keeps them
+    likely.bitA = (uint64_t)codes[0] << (60 - FIRST_TIME_BIT - NUM_TIME_BITS);
+    likely.set_b(MSFTimeCode::TimeParity::PARITY_BIT_IDX, (__builtin_popcount(codes[0]) % 2) == 0);
+
+    uint8_t sameDay = this->count;
+    if (bestMinuteOfDay < sameDay) sameDay = bestMinuteOfDay + 1;
+    for (int second = MSFSoftFrame::FIRST_A_BIT; second < FIRST_TIME_BIT; second++)
+      likely.set_a(second, this->dateBit(second, sameDay));
+    for (int second = MSFSoftFrame::FIRST_B_BIT; second < MSFTimeCode::TimeParity::PARITY_BIT_IDX;
+         second++)
+      likely.set_b(second, this->dateParityBit(second, sameDay));
+
+    MSFData decoded = likely.decode();
+    decoded.checksumPassed = decoded.checksumPassed && pTime;
+    return decoded;
+  }
+};
+
+/// @brief A single minute, nothing to combine and nothing to keep. The minute
+/// decodes on its own or not at all.
+template <>
+class MSFSoftAccumulator<1> {
+ public:
+  template <class SOFT_FRAME>
+  void add(const SOFT_FRAME&) {}
+  void reset() {}
+  uint8_t get_count() const { return 0; }
+
+  MSFData decode() const {
+    MSFData nothing;
+    nothing.checksumPassed = false;
+    return nothing;
+  }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// @brief States the MSFReceiver state machine goes through while acquiring the time, see
+/// MSFReceiver::tick() for how to drive it.
+enum class MSFState : uint8_t {
+  IDLE,     // nothing is scheduled, call start() to begin a new acquisition
+  SLEEP,    // random back-off before we start syncing
+  SYNC,     // scanning up to 65s of signal for the minute marker
+  ALIGN,    // waiting for the start of the next minute
+  VERIFY,   // tracking mode only, checking the minute marker where we expect it
+  ACQUIRE,  // sampling Bit A and Bit B windows of every second
+  DECODE,   // all 60 seconds are captured, decoding BCD values and checking parity
+  READY     // result is available via get_result()
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Number of minute marker candidates kept while scanning for the minute
+// marker. If the best one turns out to be wrong the next one is tried without
+// scanning again. Every candidate takes 14 bytes of RAM (16 on 32 bit
+// platforms).
+#ifndef MSF_TIME_LIB_SYNC_CANDIDATES
+#define MSF_TIME_LIB_SYNC_CANDIDATES 3
+#endif
+
+/// @brief One possible position of the minute marker found while scanning,
+/// scored on the marker itself and on the second edges that followed it.
+struct MSFSyncCandidate {
+  // every second starts with at least 100ms of silence after at least 200ms
+  // of carrier (300ms of carrier at the end of every second, 700ms at the end
+  // of the 59th), so this is the part of the template we check on every
+  // second after the marker
+  static const int32_t EDGE_CARRIER_BEFORE_US = 200000;
+  static const int32_t EDGE_SILENCE_AFTER_US = 100000;
+
+  uint32_t minuteStart;
+  uint32_t nextSecondEdge;
+  uint16_t markerScore;
+  uint16_t edgeSamples;
+  uint16_t edgeMatches;
+
+  /// @brief Returns how much the second edges that followed the candidate
+  /// agree with it, from -100 to 100, 0 if we have not seen any yet
+  int8_t edge_agreement() const {
+    if (this->edgeSamples == 0) return 0;
+    return (2 * (int32_t)this->edgeMatches - this->edgeSamples) * 100 / this->edgeSamples;
+  }
+
+  /// @brief Returns how well the candidate fits the minute template, the
+  /// percentage of the perfect marker score plus edge_agreement()
+  /// @param perfectMarkerScore Marker score of a perfect minute marker
+  int16_t rank(uint16_t perfectMarkerScore) const {
+    return (int16_t)((uint32_t)this->markerScore * 100 / perfectMarkerScore) +
+           this->edge_agreement();
+  }
+};
+
+/// @brief Keeps the best few minute marker candidates seen during the scan.
+/// The minute marker score alone can be beaten by a noise spike or tie with
+/// a second that just looks like the marker, which then costs a whole failed
+/// minute and a new scan. Here every candidate is also checked against the
+/// silence that starts every following second, and worse candidates are kept
+/// around so we can fall back to them.
+///
+/// Peaks less than 500ms apart (counting modulo a minute, so the same marker
+/// seen again a minute later is the same candidate) are treated as one
+/// candidate and only the better of them is kept.
+/// @tparam K Number of candidates to keep
+template <uint8_t K>
+class MSFSyncCandidates {
+  static_assert(K >= 1, "MSFSyncCandidates needs to keep at least one candidate");
+
+  static const int32_t MINUTE_US = 60000000L;
+  static const int32_t SAME_CANDIDATE_US = 500000L;
+  // moving the candidate more than this makes the edges we checked so far
+  // useless, as they were checked at a different position
+  static const int32_t SAME_EDGES_US = 50000L;
+
+  MSFSyncCandidate candidates[K];
+  uint8_t count = 0;
+  uint16_t perfectMarkerScore = 1;
+
+  // the score is offered on every sample, but we only need its peaks, so the
+  // best score is held here until the first second edge after it is due
+  uint32_t pendingMinuteStart;
+  uint16_t pendingScore = 0;
+
+  /// @brief Returns the distance of two minute starts within the minute, we
+  /// never scan for much more than a minute so this needs no division
+  static int32_t phaseDifference(uint32_t a, uint32_t b) {
+    int32_t difference = (int32_t)(a - b);
+    while (difference > MINUTE_US / 2) difference -= MINUTE_US;
+    while (difference < -MINUTE_US / 2) difference += MINUTE_US;
+    return difference;
+  }
+
+  /// @brief Returns index of the candidate with the lowest marker score. We
+  /// dont use the rank here, every peak aligned with the seconds agrees with
+  /// the second edges and the ones we have checked for longer would always
+  /// push out the new ones.
+  uint8_t weakest() const {
+    uint8_t weakestIdx = 0;
+    for (uint8_t i = 1; i < this->count; i++) {
+      if (this->candidates[i].markerScore < this->candidates[weakestIdx].markerScore)
+        weakestIdx = i;
+    }
+    return weakestIdx;
+  }
+
+  /// @brief Makes a candidate out of a minute marker peak if it beats the
+  /// candidate at the same position or the weakest one we keep
+  void insert(uint32_t minuteStart, uint16_t markerScore) {
+    for (uint8_t i = 0; i < this->count; i++) {
+      MSFSyncCandidate& candidate = this->candidates[i];
+      int32_t difference = phaseDifference(minuteStart, candidate.minuteStart);
+      if (difference <= -SAME_CANDIDATE_US || difference >= SAME_CANDIDATE_US) continue;
+      if (markerScore <= candidate.markerScore) return;
+
+      if (difference <= -SAME_EDGES_US || difference >= SAME_EDGES_US) {
+        candidate.edgeSamples = 0;
+        candidate.edgeMatches = 0;
+      }
+      candidate.minuteStart = minuteStart;
+      candidate.nextSecondEdge = minuteStart + 1000000UL;
+      candidate.markerScore = markerScore;
+      return;
+    }
+
+    uint8_t idx = this->count;
+    if (this->count == K) {
+      idx = this->weakest();
+      if (markerScore <= this->candidates[idx].markerScore) return;
+    } else {
+      this->count++;
+    }
+    MSFSyncCandidate& candidate = this->candidates[idx];
+    candidate.minuteStart = minuteStart;
+    candidate.nextSecondEdge = minuteStart + 1000000UL;
+    candidate.markerScore = markerScore;
+    candidate.edgeSamples = 0;
+    candidate.edgeMatches = 0;
+  }
+
+  /// @brief Turns the held peak into a candidate
+  void flushPending() {
+    if (this->pendingScore == 0) return;
+    this->insert(this->pendingMinuteStart, this->pendingScore);
+    this->pendingScore = 0;
+  }
+
+ public:
+  /// @brief Drops all candidates before a new scan
+  /// @param perfectScore Marker score of a perfect minute marker
+  void reset(uint16_t perfectScore) {
+    this->count = 0;
+    this->pendingScore = 0;
+    this->perfectMarkerScore = perfectScore > 0 ? perfectScore : 1;
+  }
+
+  /// @brief Offers the minute marker score of the current sample, only its
+  /// peaks end up as candidates
+  /// @param minuteStart Timestamp of the minute start the score points at
+  /// @param markerScore Minute marker score
+  void offer(uint32_t minuteStart, uint16_t markerScore) {
+    if (markerScore > this->pendingScore) {
+      this->pendingMinuteStart = minuteStart;
+      this->pendingScore = markerScore;
+    }
+  }
+
+  /// @brief Checks one carrier sample against the second edges every
+  /// candidate predicts. We only scan for cca a minute, so the counters can
+  /// not overflow even with a sample every 1ms.
+  /// @param now Timestamp of the sample in microseconds
+  /// @param carrier Carrier state at the time of the sample
+  /// @param secondPeriod Length of a second on our local clock in microseconds
+  /// @param peakAfterMinuteUs How long after the minute start the marker
+  /// scores best
+  void sample(uint32_t now, bool carrier, uint32_t secondPeriod, uint32_t peakAfterMinuteUs) {
+    // once the first second edge after the held peak is due we have to start
+    // checking it, a better peak showing up later is merged by insert() anyway.
+    // WWVB and JJY peak only 800ms into the minute when that edge is already
+    // due, there we wait a little past the peak, otherwise every step of the
+    // rising score gets its edges checked.
+    int32_t holdUs = 1000000L - MSFSyncCandidate::EDGE_CARRIER_BEFORE_US;
+    if ((int32_t)peakAfterMinuteUs + SAME_EDGES_US > holdUs)
+      holdUs = peakAfterMinuteUs + SAME_EDGES_US;
+    if (this->pendingScore > 0 && (int32_t)(now - this->pendingMinuteStart) >= holdUs)
+      this->flushPending();
+
+    for (uint8_t i = 0; i < this->count; i++) {
+      MSFSyncCandidate& candidate = this->candidates[i];
+      int32_t fromEdge = (int32_t)(now - candidate.nextSecondEdge);
+      if (fromEdge >= MSFSyncCandidate::EDGE_SILENCE_AFTER_US) {
+        candidate.nextSecondEdge += secondPeriod;
+        fromEdge -= secondPeriod;
+      }
+      if (fromEdge < -MSFSyncCandidate::EDGE_CARRIER_BEFORE_US) continue;
+
+      candidate.edgeSamples++;
+      if ((fromEdge < 0) == carrier) candidate.edgeMatches++;
+    }
+  }
+
+  /// @brief Returns edge agreement of the candidate at given position, see
+  /// MSFSyncCandidate::edge_agreement()
+  /// @param minuteStart Timestamp of the minute start of the candidate
+  /// @return Edge agreement, 0 if there is no candidate there
+  int8_t edge_agreement_at(uint32_t minuteStart) {
+    this->flushPending();
+    for (uint8_t i = 0; i < this->count; i++) {
+      int32_t difference = phaseDifference(minuteStart, this->candidates[i].minuteStart);
+      if (difference > -SAME_CANDIDATE_US && difference < SAME_CANDIDATE_US)
+        return this->candidates[i].edge_agreement();
+    }
+    return 0;
+  }
+
+  /// @brief Returns number of candidates currently kept
+  uint8_t get_count() const { return this->count; }
+
+  /// @brief Removes the best ranked candidate and returns it
+  /// @param best Output, the best ranked candidate
+  /// @return False if there are no candidates left
+  bool pop_best(MSFSyncCandidate& best) {
+    this->flushPending();
+    if (this->count == 0) return false;
+    uint8_t bestIdx = 0;
+    for (uint8_t i = 1; i < this->count; i++) {
+      if (this->candidates[i].rank(this->perfectMarkerScore) >
+          this->candidates[bestIdx].rank(this->perfectMarkerScore))
+        bestIdx = i;
+    }
+    best = this->candidates[bestIdx];
+    this->candidates[bestIdx] = this->candidates[--this->count];
+    return true;
+  }
+
+  /// @brief Returns the rank of given candidate, see MSFSyncCandidate::rank()
+  int16_t rank(const MSFSyncCandidate& candidate) const {
+    return candidate.rank(this->perfectMarkerScore);
+  }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+/// @brief Runs a MSFReceiver in tracking mode as a FreeRTOS task of its own,
+/// handing every minute that passed the checksum to a callback, a queue or
+/// both. Between its events the task is blocked and takes no CPU at all, the
+/// receiver tells us how long it can be left alone, see
+/// MSFReceiver::get_time_until_next_event(), and an interrupt can wake the
+/// task earlier with notify_from_isr().
+///
+/// The task only blocks for whole RTOS ticks (1ms on arduino-esp32). Edge
+/// capture and block sampling modes have hundreds of milliseconds between
+/// their events, so there it sleeps nearly all the time. Polling a reader
+/// function needs a sample every SAMPLE_RATE_MS while syncing and every
+/// 0.5ms while acquiring bits, the task then wakes up every tick and the
+/// Bit A/B windows get every other sample, which they can afford.
+///
+/// The task owns the receiver while it runs, so dont call the receiver from
+/// other tasks until end().
+/// @tparam RECEIVER MSFReceiver type this task drives
+template <class RECEIVER>
+class MSFTask {
+  using ResultCallback = void (*)(const MSFData&);
+
+  RECEIVER& receiver;
+  ResultCallback callback;
+  TaskHandle_t task = nullptr;
+  // holds the last result only, a consumer that is behind gets the newest
+  // minute and not a stale one
+  QueueHandle_t results = nullptr;
+  volatile bool stopping = false;
+
+  static void run(void* self) { static_cast<MSFTask*>(self)->loop(); }
+
+  void loop() {
+    this->receiver.start_tracking();
+    while (!this->stopping) {
+      if (this->receiver.tick() && this->receiver.get_result().checksumPassed) {
+        const MSFData& result = this->receiver.get_result();
+        xQueueOverwrite(this->results, &result);
+        if (this->callback) this->callback(result);
+      }
+      uint32_t wait = this->receiver.get_time_until_next_event();
+      // a tick is as short as we can block, anything shorter is rounded up
+      // so the idle task and everything below us still runs
+      TickType_t ticks = wait / (portTICK_PERIOD_MS * 1000UL);
+      if (ticks == 0) ticks = 1;
+      ulTaskNotifyTake(pdTRUE, ticks);
+    }
+    this->receiver.stop();
+    this->task = nullptr;
+    vTaskDelete(nullptr);
+  }
+
+ public:
+  /// @brief Initializes the task for given receiver, nothing runs until
+  /// begin()
+  /// @param msfReceiver Receiver to drive, it must outlive the task
+  /// @param onResult Called from the task for every minute that passed the
+  /// checksum, keep it short as the task does not sample while it runs
+  MSFTask(RECEIVER& msfReceiver, ResultCallback onResult = nullptr)
+      : receiver(msfReceiver), callback(onResult) {}
+
+  /// @brief Starts the task, pinned to given core. The default low priority
+  /// and core 1 keep it away from Wi-Fi and Bluetooth on core 0, and a
+  /// sample late by a task switch costs us much less than them.
+  /// @param priority Priority of the task, 1 is just above idle
+  /// @param core Core to pin the task to
+  /// @param stackBytes Stack of the task, more if the callback needs it
+  /// @return False if the task or its queue could not be created, or it
+  /// already runs
+  bool begin(UBaseType_t priority = 1, BaseType_t core = 1, uint32_t stackBytes = 4096) {
+    if (this->task) return false;
+    if (!this->results) this->results = xQueueCreate(1, sizeof(MSFData));
+    if (!this->results) return false;
+    this->stopping = false;
+    return xTaskCreatePinnedToCore(run, "msf", stackBytes, this, priority, &this->task, core) ==
+           pdPASS;
+  }
+
+  /// @brief Stops the task and the acquisition, the task ends on its next
+  /// wakeup so this does not wait for it. The last result stays in the
+  /// queue.
+  void end() {
+    if (!this->task) return;
+    this->stopping = true;
+    xTaskNotifyGive(this->task);
+  }
+
+  /// @brief Checks if the task runs
+  bool is_running() const { return this->task != nullptr; }
+
+  /// @brief Waits for the next minute that passed the checksum, blocking the
+  /// calling task
+  /// @param result Output, the decoded minute
+  /// @param timeout How long to wait in RTOS ticks, portMAX_DELAY for ever
+  /// @return False if there was no result in time
+  bool wait_for_result(MSFData& result, TickType_t timeout = portMAX_DELAY) {
+    if (!this->results) return false;
+    return xQueueReceive(this->results, &result, timeout) == pdTRUE;
+  }
+
+  /// @brief Wakes the task up from an interrupt, e.g. from the pin change
+  /// interrupt after MSFEdgeBuffer::push() or the timer interrupt that
+  /// completed a block of MSFSampleBuffer, so it catches up straight away
+  /// instead of at its next deadline
+  void notify_from_isr() {
+    if (!this->task) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(this->task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+};
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFData.h"
+
+/// @brief Describes one BCD field of the time code in Bit A. MSF transmits
+/// fields most significant bit first, tens followed by 4 bits of units, so the
+/// value is simply (raw >> 4) * 10 + (raw & 0x0F) once the bits are read in
+/// the order they came in. DCF77 sends them the other way round, units first
+/// and least significant bit first, which only needs them reversed.
+/// @tparam START Second of the minute carrying the first bit of the field
+/// @tparam WIDTH Number of bits in the field
+/// @tparam LSB_FIRST The field is sent least significant bit first
+template <uint8_t START, uint8_t WIDTH, bool LSB_FIRST = false>
+struct MSFBCDField {
+  static_assert(WIDTH >= 1 && WIDTH <= 8, "MSF BCD fields are between 1 and 8 bits wide");
+  static_assert(START + WIDTH <= 60, "MSF BCD field must fit in the minute");
+
+  static const uint8_t START_BIT = START;
+  static const uint8_t NUM_BITS = WIDTH;
+  static const bool REVERSED = LSB_FIRST;
+};
+
+/// @brief Describes a group of Bit A bits covered by one parity bit, odd
+/// parity in Bit B as MSF has it unless told otherwise
+/// @tparam START Second of the minute carrying the first bit of the group
+/// @tparam WIDTH Number of bits in the group
+/// @tparam PARITY_BIT Second of the minute carrying the parity
+/// @tparam COVERS What the group covers, MSFSignalQuality parity flags
+/// @tparam PARITY_IN_B The parity is in Bit B, otherwise in Bit A with the
+/// rest of the time code
+/// @tparam ODD The group and its parity bit add up to odd number of ones,
+/// otherwise to even
+template <uint8_t START, uint8_t WIDTH, uint8_t PARITY_BIT, uint8_t COVERS = 0,
+          bool PARITY_IN_B = true, bool ODD = true>
+struct MSFParityGroup {
+  static_assert(START + WIDTH <= 60 && PARITY_BIT < 60, "MSF parity group must fit in the minute");
+
+  static const uint8_t START_BIT = START;
+  static const uint8_t NUM_BITS = WIDTH;
+  static const uint8_t PARITY_BIT_IDX = PARITY_BIT;
+  static const uint8_t COVERED = COVERS;
+  static const bool IN_B = PARITY_IN_B;
+  static const bool ODD_PARITY = ODD;
+};
+
+/// @brief Layout of the MSF time code as in MSF spec document at:
+/// https://www.pvelectronics.co.uk/rftime/msf/MSF_Time_Date_Code.pdf
+struct MSFTimeCode {
+  using Year = MSFBCDField<17, 8>;
+  using Month = MSFBCDField<25, 5>;
+  using Day = MSFBCDField<30, 6>;
+  using DayOfTheWeek = MSFBCDField<36, 3>;
+  using Hour = MSFBCDField<39, 6>;
+  using Minute = MSFBCDField<45, 7>;
+
+  // each piece of information has its own parity bit, note that the date one
+  // covers month and day and the time one covers hour and minute
+  using YearParity = MSFParityGroup<17, 8, 54, MSFSignalQuality::YEAR_PARITY>;
+  using DateParity = MSFParityGroup<25, 11, 55, MSFSignalQuality::DATE_PARITY>;
+  using DayOfTheWeekParity = MSFParityGroup<36, 3, 56, MSFSignalQuality::DAY_OF_THE_WEEK_PARITY>;
+  using TimeParity = MSFParityGroup<39, 13, 57, MSFSignalQuality::TIME_PARITY>;
+
+  // DUT1 (UT1 - UTC) is sent in unary in Bit B without any parity, every bit
+  // set adds 0.1s, seconds 1 to 8 carry positive and 9 to 16 negative values
+  static const uint8_t DUT1_POSITIVE_START_BIT = 1;
+  static const uint8_t DUT1_NEGATIVE_START_BIT = 9;
+  static const uint8_t DUT1_NUM_BITS = 8;
+  // Bit B of second 53 is set during the hour before the summer time changes
+  // and Bit B of second 58 while it is in effect
+  static const uint8_t SUMMER_TIME_WARNING_BIT_IDX = 53;
+  static const uint8_t SUMMER_TIME_BIT_IDX = 58;
+};
+
+/// @brief Layout of the DCF77 time code, there is a single bit per second
+/// which goes to Bit A. Every second starts with the carrier reduced for 100ms
+/// (0) or 200ms (1), apart from the 59th which has no reduction at all. Fields
+/// are BCD sent least significant bit first, the time is CET or CEST of the
+/// minute that starts at the next minute marker, as with MSF.
+struct DCF77TimeCode {
+  using Minute = MSFBCDField<21, 7, true>;
+  using Hour = MSFBCDField<29, 6, true>;
+  using Day = MSFBCDField<36, 6, true>;
+  using DayOfTheWeek = MSFBCDField<42, 3, true>;
+  using Month = MSFBCDField<45, 5, true>;
+  using Year = MSFBCDField<50, 8, true>;
+
+  // even parity, the bit follows the bits it covers. The date one covers day,
+  // day of the week, month and year.
+  using MinuteParity = MSFParityGroup<21, 7, 28, MSFSignalQuality::TIME_PARITY, false, false>;
+  using HourParity = MSFParityGroup<29, 6, 35, MSFSignalQuality::TIME_PARITY, false, false>;
+  using DateParity =
+      MSFParityGroup<36, 22, 58,
+                     MSFSignalQuality::YEAR_PARITY | MSFSignalQuality::DATE_PARITY |
+                         MSFSignalQuality::DAY_OF_THE_WEEK_PARITY,
+                     false, false>;
+
+  // the start of the minute is always 0 and the start of the time always 1
+  static const uint8_t MINUTE_START_BIT_IDX = 0;
+  static const uint8_t TIME_START_BIT_IDX = 20;
+  // set during the hour before summer time changes, then exactly one of the
+  // next two tells which time is in effect
+  static const uint8_t SUMMER_TIME_WARNING_BIT_IDX = 16;
+  static const uint8_t SUMMER_TIME_BIT_IDX = 17;
+  static const uint8_t STANDARD_TIME_BIT_IDX = 18;
+};
+
+/// @brief Layout of the WWVB time code. Every second starts with the power
+/// reduced for 200ms (0), 500ms (1) or 800ms (marker), the bit goes to Bit A
+/// and the marker to Bit B. Fields are BCD most significant bit first, but
+/// with a 0 or a marker between the digits, so every digit is a field of its
+/// own. The time is UTC of the minute that starts at the marker of the frame,
+/// a minute earlier than MSF transmits.
+struct WWVBTimeCode {
+  using MinuteTens = MSFBCDField<1, 3>;
+  using MinuteUnits = MSFBCDField<5, 4>;
+  using HourTens = MSFBCDField<12, 2>;
+  using HourUnits = MSFBCDField<15, 4>;
+  using DayOfYearHundreds = MSFBCDField<22, 2>;
+  using DayOfYearTens = MSFBCDField<25, 4>;
+  using DayOfYearUnits = MSFBCDField<30, 4>;
+  // DUT1 sign is 101 for positive and 010 for negative, followed by the
+  // magnitude in tenths of a second
+  using DUT1Sign = MSFBCDField<36, 3>;
+  using DUT1 = MSFBCDField<40, 4>;
+  using YearTens = MSFBCDField<45, 4>;
+  using YearUnits = MSFBCDField<50, 4>;
+
+  // markers are the seconds ending in 9 and the 0th one, the unused seconds
+  // are always 0
+  static const uint8_t MARKER_EVERY = 10;
+  static const uint64_t ZERO_BITS = (1ULL << (59 - 4)) | (1ULL << (59 - 10)) |
+                                    (1ULL << (59 - 11)) | (1ULL << (59 - 14)) |
+                                    (1ULL << (59 - 20)) | (1ULL << (59 - 21)) |
+                                    (1ULL << (59 - 24)) | (1ULL << (59 - 34)) |
+                                    (1ULL << (59 - 35)) | (1ULL << (59 - 44)) | (1ULL << (59 - 54));
+  static const uint8_t LEAP_YEAR_BIT_IDX = 55;
+  // summer time in effect at 24:00 and at 00:00 UTC of the current day, they
+  // differ on the day it changes
+  static const uint8_t SUMMER_TIME_TONIGHT_BIT_IDX = 57;
+  static const uint8_t SUMMER_TIME_BIT_IDX = 58;
+};
+
+/// @brief Layout of the JJY time code. Every second starts with the power
+/// raised for 800ms (0), 500ms (1) or 200ms (marker), the other way round
+/// than WWVB, so the receiver inverts the reads, see JJYProtocol. The bit goes
+/// to Bit A and the marker to Bit B, the minute, hour and day of the year are
+/// where WWVB has them. The time is JST of the minute that starts at the
+/// marker of the frame.
+struct JJYTimeCode {
+  using MinuteTens = MSFBCDField<1, 3>;
+  using MinuteUnits = MSFBCDField<5, 4>;
+  using HourTens = MSFBCDField<12, 2>;
+  using HourUnits = MSFBCDField<15, 4>;
+  using DayOfYearHundreds = MSFBCDField<22, 2>;
+  using DayOfYearTens = MSFBCDField<25, 4>;
+  using DayOfYearUnits = MSFBCDField<30, 4>;
+  using Year = MSFBCDField<41, 8>;
+  // 0 is Sunday
+  using DayOfTheWeek = MSFBCDField<50, 3>;
+
+  // even parity of the hour and of the minute
+  using HourParity = MSFParityGroup<12, 7, 36, MSFSignalQuality::TIME_PARITY, false, false>;
+  using MinuteParity = MSFParityGroup<1, 8, 37, MSFSignalQuality::TIME_PARITY, false, false>;
+
+  static const uint8_t MARKER_EVERY = 10;
+  static const uint64_t ZERO_BITS = (1ULL << (59 - 4)) | (1ULL << (59 - 10)) |
+                                    (1ULL << (59 - 11)) | (1ULL << (59 - 14)) |
+                                    (1ULL << (59 - 20)) | (1ULL << (59 - 21)) |
+                                    (1ULL << (59 - 24)) | (1ULL << (59 - 34)) |
+                                    (1ULL << (59 - 35));
+  // at these minutes seconds 40 to 48 carry the call sign instead of the year
+  // and the day of the week
+  static const uint8_t CALL_SIGN_MINUTE = 15;
+  static const uint8_t CALL_SIGN_MINUTE_2 = 45;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// @brief Layout of a carrier trace, as small as we could make it so a whole
+/// sync and decode fits into the RAM of the device that records it:
+///
+/// - 4 bytes of MAGIC, 1 byte of VERSION
+/// - 1 byte with the carrier state at the start of the trace, 1 for carrier
+///   and 0 for silence
+/// - how long each state lasted, in UNIT_US units, after each of them the
+///   state flips. Every length is an unsigned LEB128 number, 7 bits per byte
+///   starting with the lowest ones and the top bit set on all but the last
+///   byte, so the 100ms to 900ms runs of clean signal take 2 bytes each.
+///
+/// MSFTraceRecorder writes it on the device, MSFTraceReplay in extras/host
+/// plays it back.
+struct MSFTraceFormat {
+  static constexpr const char* MAGIC = "MSFT";
+  static const uint8_t VERSION = 1;
+  static const uint8_t HEADER_SIZE = 6;
+  static const uint32_t UNIT_US = 100;
+};
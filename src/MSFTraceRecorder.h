@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "MSFTraceFormat.h"
+
+/// @brief Records the carrier as the receiver module outputs it into a
+/// buffer of the caller, in MSFTraceFormat, so a failure in the field can be
+/// replayed on a PC with extras/host/simulate.cpp --trace. Only the
+/// transitions are kept, 2 bytes each on a clean signal, so a sync and decode
+/// of two minutes fits in well under 1KB where a packed 1ms bitstream would
+/// take 15KB.
+///
+/// Feed it from wherever the carrier is read, the reader function or the pin
+/// change interrupt of edge capture mode, with the same state the receiver
+/// gets. A buffer too small for the whole capture can be emptied into a
+/// Serial, SD or flash stream with flush() as it goes.
+///
+/// When the buffer fills up the recording stops there, the trace up to that
+/// point still replays, just shorter.
+class MSFTraceRecorder {
+  uint8_t* const buffer;
+  const size_t capacity;
+  size_t size = 0;
+
+  bool recording = false;
+  bool truncated = false;
+  // header is written with the first state we see
+  bool started = false;
+  bool carrier = true;
+  // micros() timestamp of the last transition, and what was left of it after
+  // counting the run in whole units so the rounding does not add up
+  uint32_t runStartMicros = 0;
+  uint32_t runStartRemainderUs = 0;
+
+  /// @brief Appends one byte, it must fit
+  void append(uint8_t byte) { this->buffer[this->size++] = byte; }
+
+  /// @brief Appends the run that ended at given time as a LEB128 number
+  /// @return False if it does not fit
+  bool appendRun(uint32_t timestampMicros) {
+    uint32_t elapsed = timestampMicros - this->runStartMicros + this->runStartRemainderUs;
+    uint32_t units = elapsed / MSFTraceFormat::UNIT_US;
+    uint8_t bytes = 1;
+    for (uint32_t rest = units >> 7; rest > 0; rest >>= 7) bytes++;
+    if (this->size + bytes > this->capacity) return false;
+    do {
+      uint8_t byte = units & 0x7F;
+      units >>= 7;
+      this->append(units > 0 ? byte | 0x80 : byte);
+    } while (units > 0);
+    this->runStartMicros = timestampMicros;
+    this->runStartRemainderUs = elapsed % MSFTraceFormat::UNIT_US;
+    return true;
+  }
+
+ public:
+  /// @param traceBuffer Buffer the trace is written into, it must outlive
+  /// the recorder
+  /// @param bufferSize Size of the buffer in bytes, at least
+  /// MSFTraceFormat::HEADER_SIZE
+  MSFTraceRecorder(uint8_t* traceBuffer, size_t bufferSize)
+      : buffer(traceBuffer), capacity(bufferSize) {}
+
+  /// @brief Starts a new trace, dropping whatever was recorded so far. It
+  /// begins with the next record().
+  void start() {
+    this->size = 0;
+    this->started = false;
+    this->truncated = false;
+    this->recording = this->capacity >= MSFTraceFormat::HEADER_SIZE;
+  }
+
+  /// @brief Records the carrier state at given time, only its transitions
+  /// take any space. Cheap enough for an interrupt, but dont call it from two
+  /// places at once.
+  /// @param timestampMicros micros() timestamp of the read or the edge, runs
+  /// up to cca 71 minutes can be measured
+  /// @param carrierState Carrier state at that time, as the receiver gets it
+  void record(uint32_t timestampMicros, bool carrierState) {
+    if (!this->recording) return;
+    if (!this->started) {
+      for (uint8_t i = 0; i < 4; i++) this->append(MSFTraceFormat::MAGIC[i]);
+      this->append(MSFTraceFormat::VERSION);
+      this->append(carrierState);
+      this->started = true;
+      this->carrier = carrierState;
+      this->runStartMicros = timestampMicros;
+      this->runStartRemainderUs = 0;
+      return;
+    }
+    if (carrierState == this->carrier) return;
+    if (!this->appendRun(timestampMicros)) {
+      this->recording = false;
+      this->truncated = true;
+      return;
+    }
+    this->carrier = carrierState;
+  }
+
+  /// @brief Ends the trace, writing out the state in progress so the trace
+  /// lasts until given time
+  /// @param timestampMicros micros() timestamp the trace ends at
+  void stop(uint32_t timestampMicros) {
+    if (this->recording && this->started && !this->appendRun(timestampMicros))
+      this->truncated = true;
+    this->recording = false;
+  }
+
+  /// @brief Checks the recorder takes the transitions, that is it was
+  /// started and is neither stopped nor full
+  bool is_recording() const { return this->recording; }
+
+  /// @brief Checks the buffer filled up and the trace ends early
+  bool is_truncated() const { return this->truncated; }
+
+  /// @brief Returns the trace recorded so far, less what flush() took
+  const uint8_t* get_data() const { return this->buffer; }
+
+  /// @brief Returns the size of get_data() in bytes
+  size_t get_size() const { return this->size; }
+
+  /// @brief Writes the trace recorded so far into a stream and empties the
+  /// buffer, so a long capture can be written out as it goes. If it is fed
+  /// from an interrupt, call this with interrupts disabled.
+  /// @tparam OUTPUT Anything with write(const uint8_t*, size_t), such as
+  /// Print (Serial, an SD File) on Arduino
+  /// @param output Stream to write to
+  /// @return Number of bytes written
+  template <class OUTPUT>
+  size_t flush(OUTPUT& output) {
+    size_t written = this->size > 0 ? output.write(this->buffer, this->size) : 0;
+    this->size = 0;
+    return written;
+  }
+};